@@ -1,4 +1,19 @@
 #include <bits/stdc++.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <io.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PDPTW_X86 1
+#endif
 using namespace std;
 
 struct Node {
@@ -17,6 +32,219 @@ struct Node {
     bool is_delivery() const { return demand < 0; }
 };
 
+// Allocator handing out cache-line aligned storage for Matrix
+template <typename T>
+struct AlignedAllocator {
+    using value_type = T;
+    static const size_t alignment = 64;
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U> &) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), align_val_t(alignment))); }
+    void deallocate(T *p, size_t) { ::operator delete(p, align_val_t(alignment)); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U> &) const { return false; }
+};
+
+// Contiguous row-major n x m matrix. Rows are padded to a multiple of 64 bytes
+// so every row starts on a cache line and SIMD kernels can run over whole rows.
+// m[i][j] works as it did with vector<vector<T>>. A matrix can also be a view
+// over external memory laid out the same way (e.g. a mapped instance file),
+// which it keeps alive through owner.
+template <typename T>
+class Matrix {
+public:
+    static int padded_stride(int cols) {
+        const int per_line = AlignedAllocator<T>::alignment / sizeof(T);
+        return (cols + per_line - 1) / per_line * per_line;
+    }
+
+    Matrix() = default;
+    Matrix(int rows, int cols, T value = T()) { assign(rows, cols, value); }
+    Matrix(const Matrix &other) { *this = other; }
+    Matrix(Matrix &&other) noexcept { *this = move(other); }
+
+    Matrix &operator=(const Matrix &other) {
+        if (this != &other) {
+            num_rows = other.num_rows;
+            num_cols = other.num_cols;
+            row_stride = other.row_stride;
+            storage = other.storage;
+            owner = other.owner;
+            base = owner ? other.base : storage.data();
+        }
+        return *this;
+    }
+
+    Matrix &operator=(Matrix &&other) noexcept {
+        if (this != &other) {
+            num_rows = other.num_rows;
+            num_cols = other.num_cols;
+            row_stride = other.row_stride;
+            storage = move(other.storage);
+            owner = move(other.owner);
+            base = owner ? other.base : storage.data();
+            other.base = nullptr;
+            other.num_rows = other.num_cols = other.row_stride = 0;
+        }
+        return *this;
+    }
+
+    void assign(int rows, int cols, T value = T()) {
+        num_rows = rows;
+        num_cols = cols;
+        row_stride = padded_stride(cols);
+        owner.reset();
+        storage.assign((size_t)rows * row_stride, value);
+        base = storage.data();
+    }
+
+    // data must be 64-byte aligned with padded_stride(cols) entries per row
+    void view(T *data, int rows, int cols, shared_ptr<void> keep_alive) {
+        num_rows = rows;
+        num_cols = cols;
+        row_stride = padded_stride(cols);
+        storage.clear();
+        storage.shrink_to_fit();
+        owner = move(keep_alive);
+        base = data;
+    }
+
+    // Moves owned storage behind a shared owner, so copies of this matrix alias
+    // one read-only buffer instead of duplicating it
+    void share() {
+        if (owner)
+            return;
+        auto shared = make_shared<vector<T, AlignedAllocator<T>>>(move(storage));
+        base = shared->data();
+        owner = shared;
+    }
+
+    T *operator[](int row) { return base + (size_t)row * row_stride; }
+    const T *operator[](int row) const { return base + (size_t)row * row_stride; }
+
+    int rows() const { return num_rows; }
+    int cols() const { return num_cols; }
+    int stride() const { return row_stride; }
+    T *data() { return base; }
+    const T *data() const { return base; }
+    size_t padded_size() const { return (size_t)num_rows * row_stride; }
+
+private:
+    int num_rows = 0;
+    int num_cols = 0;
+    int row_stride = 0;
+    T *base = nullptr;
+    vector<T, AlignedAllocator<T>> storage;
+    shared_ptr<void> owner;
+};
+
+// Vectorized kernels over matrix storage. The AVX2 versions are compiled with a
+// target attribute and picked at runtime, so the default -O2 build still uses
+// them on machines that have AVX2; SSE2 is the x86-64 baseline.
+#ifdef PDPTW_X86
+__attribute__((target("avx2"))) void scale_clamp_avx2(double *data, size_t count, double factor, double lo,
+                                                      double hi) {
+    __m256d f = _mm256_set1_pd(factor), vlo = _mm256_set1_pd(lo), vhi = _mm256_set1_pd(hi);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d x = _mm256_mul_pd(_mm256_load_pd(data + i), f);
+        _mm256_store_pd(data + i, _mm256_min_pd(_mm256_max_pd(x, vlo), vhi));
+    }
+    for (; i < count; i++) {
+        data[i] = min(max(data[i] * factor, lo), hi);
+    }
+}
+
+__attribute__((target("avx2"))) void masked_row_sums_avx2(const double *values, const int *weights, int count,
+                                                         double &value_sum, double &inverse_sum) {
+    __m256d vsum = _mm256_setzero_pd(), isum = _mm256_setzero_pd();
+    __m256d one = _mm256_set1_pd(1.0), zero = _mm256_setzero_pd();
+    int j = 0;
+    for (; j + 4 <= count; j += 4) {
+        __m256d w = _mm256_cvtepi32_pd(_mm_load_si128((const __m128i *)(weights + j)));
+        __m256d mask = _mm256_cmp_pd(w, zero, _CMP_GT_OQ);
+        vsum = _mm256_add_pd(vsum, _mm256_and_pd(mask, _mm256_load_pd(values + j)));
+        isum = _mm256_add_pd(isum, _mm256_and_pd(mask, _mm256_div_pd(one, _mm256_add_pd(w, one))));
+    }
+    double v[4], inv[4];
+    _mm256_storeu_pd(v, vsum);
+    _mm256_storeu_pd(inv, isum);
+    value_sum = v[0] + v[1] + v[2] + v[3];
+    inverse_sum = inv[0] + inv[1] + inv[2] + inv[3];
+    for (; j < count; j++) {
+        if (weights[j] > 0) {
+            value_sum += values[j];
+            inverse_sum += 1.0 / (weights[j] + 1.0);
+        }
+    }
+}
+
+void scale_clamp_sse2(double *data, size_t count, double factor, double lo, double hi) {
+    __m128d f = _mm_set1_pd(factor), vlo = _mm_set1_pd(lo), vhi = _mm_set1_pd(hi);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d x = _mm_mul_pd(_mm_load_pd(data + i), f);
+        _mm_store_pd(data + i, _mm_min_pd(_mm_max_pd(x, vlo), vhi));
+    }
+    for (; i < count; i++) {
+        data[i] = min(max(data[i] * factor, lo), hi);
+    }
+}
+
+bool cpu_has_avx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+#endif
+
+void scale_clamp_scalar(double *data, size_t count, double factor, double lo, double hi) {
+    for (size_t i = 0; i < count; i++) {
+        data[i] = min(max(data[i] * factor, lo), hi);
+    }
+}
+
+void masked_row_sums_scalar(const double *values, const int *weights, int count, double &value_sum,
+                            double &inverse_sum) {
+    value_sum = 0.0;
+    inverse_sum = 0.0;
+    for (int j = 0; j < count; j++) {
+        if (weights[j] > 0) {
+            value_sum += values[j];
+            inverse_sum += 1.0 / (weights[j] + 1.0);
+        }
+    }
+}
+
+// data[i] = clamp(data[i] * factor, lo, hi) over the whole padded storage
+void scale_clamp(Matrix<double> &m, double factor, double lo, double hi) {
+#ifdef PDPTW_X86
+    if (cpu_has_avx2())
+        scale_clamp_avx2(m.data(), m.padded_size(), factor, lo, hi);
+    else
+        scale_clamp_sse2(m.data(), m.padded_size(), factor, lo, hi);
+#else
+    scale_clamp_scalar(m.data(), m.padded_size(), factor, lo, hi);
+#endif
+}
+
+// Sums values[row][j] and 1 / (weights[row][j] + 1) over the j with a positive weight
+void masked_row_sums(const Matrix<double> &values, const Matrix<int> &weights, int row, double &value_sum,
+                     double &inverse_sum) {
+#ifdef PDPTW_X86
+    if (cpu_has_avx2()) {
+        masked_row_sums_avx2(values[row], weights[row], values.cols(), value_sum, inverse_sum);
+        return;
+    }
+#endif
+    masked_row_sums_scalar(values[row], weights[row], values.cols(), value_sum, inverse_sum);
+}
+
 struct Instance {
     string name;
     string location;
@@ -24,7 +252,8 @@ struct Instance {
     int capacity;
     int route_time;
     vector<Node> nodes;
-    vector<vector<int>> travel_times;
+    Matrix<int> travel_times;
+    uint64_t id = 0; // set by prepare_instance, tells cached routes of different instances apart
 };
 
 // Hybrid Parameters - configurable by user
@@ -40,20 +269,528 @@ struct HybridParams {
     int elite_solutions = 4;
     double local_search_prob = 0.7;
     int restart_threshold = 9;
+    int regret_k = 1; // 1 = cheapest insertion, k >= 2 = regret-k
+    int granular_k = 0; // candidate neighbours per node, 0 = consider all positions
+    int local_search = 1; // 0 = 2-opt, 1 = pair moves first improvement, 2 = best improvement
+    int time_limit_ms = 0; // wall-clock budget per solve, 0 = unlimited
+    int islands = 1; // independent colonies, 1 = single colony
+    int migration_interval = 5; // island iterations between migrations
+    double migration_blend = 0.2; // share of the neighbour's trails mixed in on migration
+    int cluster_pairs = 0; // pairs per decomposition subproblem, 0 = solve the instance whole
+    int alns_iterations = 0; // ALNS iterations after each colony run, 0 = off
+    int elite_pool = 0; // solutions kept for path relinking across iterations, 0 = off
+    int num_threads = 1;
+    unsigned seed = 0;
+};
+
+// Global variables. Solver state is per thread so that batch mode can solve
+// several small instances side by side; a solve spread over the worker pool
+// hands its state to the workers first (share_solver_state).
+thread_local Instance instance;
+thread_local Node depot;
+thread_local vector<Node> pickup_nodes;
+thread_local vector<Node> delivery_nodes;
+thread_local vector<int> pickup_index; // node id -> index in pickup_nodes, -1 if not a pickup
+thread_local HybridParams hybrid_params;
+
+// Pheromone trails of a colony. Small instances keep the dense n x n matrix,
+// evaporated in one vectorized sweep per iteration. The sparse store keeps
+// only the edges from each node to its related nodes, and every other edge
+// shares one default value; deposits on those are dropped. It evaporates
+// lazily: a value remembers the iteration it was written in and, when read,
+// decays by the factor per iteration since, clamped like the dense sweep.
+// An iteration then costs time in the edges it reads or reinforces.
+class PheromoneTrails {
+public:
+    void init_dense(int n, double value) {
+        is_sparse = false;
+        dense.assign(n, n, value);
+    }
+
+    // rows[i] lists the stored edges of node i; times decides which of the
+    // others count in row_sum
+    void init_sparse(int n, double value, const vector<vector<int>> &rows, const Matrix<int> &times) {
+        is_sparse = true;
+        dense = Matrix<double>();
+        row_start.assign(n + 1, 0);
+        cols.clear();
+        outside_positive.assign(n, 0);
+        for (int i = 0; i < n; i++) {
+            vector<int> row = rows[i];
+            sort(row.begin(), row.end());
+            row.erase(unique(row.begin(), row.end()), row.end());
+            int positive = 0;
+            for (int j : row)
+                positive += times[i][j] > 0;
+            for (int j = 0; j < n; j++)
+                outside_positive[i] += times[i][j] > 0;
+            outside_positive[i] -= positive;
+            cols.insert(cols.end(), row.begin(), row.end());
+            row_start[i + 1] = cols.size();
+        }
+        values.assign(cols.size(), value);
+        stamps.assign(cols.size(), 0);
+        default_value = value;
+        default_stamp = 0;
+        now = 0;
+        decay.assign(1, 1.0);
+    }
+
+    bool sparse() const { return is_sparse; }
+    const Matrix<double> &matrix() const { return dense; }
+    size_t stored_edges() const { return is_sparse ? cols.size() : (size_t)dense.rows() * dense.cols(); }
+
+    size_t memory_bytes() const {
+        if (!is_sparse)
+            return dense.padded_size() * sizeof(double);
+        return row_start.size() * sizeof(int) + cols.size() * (sizeof(int) * 2 + sizeof(double)) +
+               outside_positive.size() * sizeof(int) + decay.size() * sizeof(double);
+    }
+
+    double get(int i, int j) const {
+        if (!is_sparse)
+            return dense[i][j];
+        int e = find(i, j);
+        return e < 0 ? current(default_value, default_stamp) : current(values[e], stamps[e]);
+    }
+
+    // Adds delta to edge i -> j, capped at cap
+    void deposit(int i, int j, double delta, double cap) {
+        if (!is_sparse) {
+            dense[i][j] = min(cap, dense[i][j] + delta);
+            return;
+        }
+        int e = find(i, j);
+        if (e < 0)
+            return;
+        values[e] = min(cap, current(values[e], stamps[e]) + delta);
+        stamps[e] = now;
+    }
+
+    // Every edge becomes clamp(value * factor, lo, hi). The sparse store only
+    // advances its clock; factor and bounds must stay the same between calls.
+    void evaporate(double factor, double lo, double hi) {
+        if (!is_sparse) {
+            scale_clamp(dense, factor, lo, hi);
+            return;
+        }
+        decay_factor = factor;
+        min_value = lo;
+        max_value = hi;
+        now++;
+        if (decay.size() <= now)
+            decay.push_back(decay.back() * factor);
+    }
+
+    // Sum of row i over the edges with positive travel time in times
+    double row_sum(int i, const Matrix<int> &times) const {
+        double sum = 0.0;
+        if (!is_sparse) {
+            double unused;
+            masked_row_sums(dense, times, i, sum, unused);
+            return sum;
+        }
+        for (int e = row_start[i]; e < row_start[i + 1]; e++) {
+            if (times[i][cols[e]] > 0)
+                sum += current(values[e], stamps[e]);
+        }
+        return sum + outside_positive[i] * current(default_value, default_stamp);
+    }
+
+    // Sum over the given edges of row i
+    template <class Edges>
+    double edge_sum(int i, const Edges &edges, const Matrix<int> &times) const {
+        double sum = 0.0;
+        for (int j : edges) {
+            if (times[i][j] > 0)
+                sum += get(i, j);
+        }
+        return sum;
+    }
+
+    // Every edge becomes (1 - w) * own + w * other; both stores have the same layout
+    void blend(const PheromoneTrails &other, double w) {
+        if (!is_sparse) {
+            double *tau = dense.data();
+            const double *theirs = other.dense.data();
+            for (size_t j = 0; j < dense.padded_size(); j++)
+                tau[j] = (1.0 - w) * tau[j] + w * theirs[j];
+            return;
+        }
+        for (size_t e = 0; e < values.size(); e++) {
+            values[e] = (1.0 - w) * current(values[e], stamps[e]) + w * other.current(other.values[e], other.stamps[e]);
+            stamps[e] = now;
+        }
+        default_value = (1.0 - w) * current(default_value, default_stamp) +
+                        w * other.current(other.default_value, other.default_stamp);
+        default_stamp = now;
+    }
+
+private:
+    bool is_sparse = false;
+    Matrix<double> dense;
+    vector<int> row_start;
+    vector<int> cols; // sorted within each row
+    vector<double> values;
+    vector<int> stamps;
+    vector<int> outside_positive; // per row, unstored edges with positive travel time
+    double default_value = 0.0;
+    int default_stamp = 0;
+    int now = 0;
+    double decay_factor = 1.0;
+    double min_value = 0.0;
+    double max_value = 0.0;
+    vector<double> decay; // decay[t] = decay_factor^t
+
+    int find(int i, int j) const {
+        auto first = cols.begin() + row_start[i], last = cols.begin() + row_start[i + 1];
+        auto it = lower_bound(first, last, j);
+        return it != last && *it == j ? it - cols.begin() : -1;
+    }
+
+    double current(double value, int stamp) const {
+        if (stamp == now)
+            return value;
+        return min(max(value * decay[now - stamp], min_value), max_value);
+    }
+};
+
+struct HybridSolution;
+
+// One ant colony: its trails, the pickup attractiveness derived from them and
+// its own copy of the ACO parameters. The solver normally runs one colony;
+// island mode runs several side by side.
+struct Colony {
+    HybridParams params;
+    PheromoneTrails pheromone;
+    vector<double> pickup_attractiveness;
+    // The last iteration's ant solutions and their order, best first. The
+    // slots are rebuilt in place every iteration and ranked by index.
+    vector<HybridSolution> solutions;
+    vector<int> ranking;
+};
+
+// Anytime control. The clock starts when a solve is requested; the search
+// loops poll solve_should_stop() and fall through with the best solution so
+// far once the time limit has passed or SIGINT/SIGTERM raised stop_requested.
+atomic<bool> stop_requested(false);
+thread_local atomic<bool> deadline_reached(false);
+thread_local chrono::steady_clock::time_point solve_start;
+thread_local chrono::steady_clock::time_point solve_deadline = chrono::steady_clock::time_point::max();
+// Receives one NDJSON progress event per line when set
+thread_local function<void(const string &)> progress_sink;
+
+void start_solve_clock(chrono::steady_clock::time_point start) {
+    solve_start = start;
+    deadline_reached = false;
+    solve_deadline = hybrid_params.time_limit_ms > 0 ? start + chrono::milliseconds(hybrid_params.time_limit_ms)
+                                                      : chrono::steady_clock::time_point::max();
+}
+
+bool solve_should_stop() {
+    if (stop_requested.load(memory_order_relaxed) || deadline_reached.load(memory_order_relaxed))
+        return true;
+    if (chrono::steady_clock::now() < solve_deadline)
+        return false;
+    deadline_reached = true;
+    return true;
+}
+
+double solve_elapsed_ms() { return chrono::duration<double, milli>(chrono::steady_clock::now() - solve_start).count(); }
+
+// Hot-path instrumentation: scoped phase timers and event counters, kept per
+// thread and summed for the report. Build with -DPDPTW_NO_PROFILE to compile
+// every PROFILE_* site out. Trace events are only kept when --trace is given.
+#ifndef PDPTW_NO_PROFILE
+#define PDPTW_PROFILE 1
+#endif
+
+enum ProfilePhase {
+    PHASE_SOLVE,
+    PHASE_COLONY_ITERATION,
+    PHASE_GREEDY,
+    PHASE_CONSTRUCT,
+    PHASE_LOCAL_SEARCH_2OPT,
+    PHASE_LOCAL_SEARCH_PAIRS,
+    PHASE_UPDATE_PHEROMONE,
+    PHASE_ALNS,
+    PHASE_PATH_RELINK,
+    PHASE_COUNT
+};
+const char *PROFILE_PHASE_NAMES[PHASE_COUNT] = {"solve_instance",    "colony_iteration",  "greedy_insertion",
+                                                "construct_solution", "local_search_2opt", "local_search_pairs",
+                                                "update_pheromone",   "alns",              "path_relink"};
+
+enum ProfileCounter {
+    COUNT_INSERTION_CHECKS,
+    COUNT_FEASIBLE_INSERTIONS,
+    COUNT_ROUTE_COPIES,
+    COUNT_LOCAL_SEARCH_MOVES,
+    COUNT_COUNTERS
+};
+const char *PROFILE_COUNTER_NAMES[COUNT_COUNTERS] = {"insertion_checks", "feasible_insertions", "route_copies",
+                                                     "local_search_moves"};
+
+#ifdef PDPTW_PROFILE
+struct TraceEvent {
+    int phase;
+    long long start_us;
+    long long duration_us;
+};
+
+struct ProfileThread {
+    int tid = 0;
+    long long phase_calls[PHASE_COUNT] = {};
+    long long phase_ns[PHASE_COUNT] = {};
+    long long counters[COUNT_COUNTERS] = {};
+    vector<TraceEvent> events;
+};
+
+class Profiler {
+public:
+    bool tracing = false;
+    chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+    static const size_t MAX_TRACE_EVENTS = 1000000; // per thread
+
+    // The calling thread's slot, taken on first use. An exiting thread hands
+    // its slot back and the next new thread carries on with it, counters
+    // included, so threads started per batch (packed lanes) do not grow the
+    // registry. Slots are never freed, so the pointer stays valid.
+    ProfileThread &local() {
+        struct Registration {
+            Profiler *owner = nullptr;
+            ProfileThread *slot = nullptr;
+            ~Registration() {
+                if (slot) {
+                    lock_guard<mutex> lock(owner->mtx);
+                    owner->idle.push_back(slot);
+                }
+            }
+        };
+        thread_local Registration current;
+        if (!current.slot) {
+            lock_guard<mutex> lock(mtx);
+            if (!idle.empty()) {
+                current.slot = idle.back();
+                idle.pop_back();
+            } else {
+                threads.push_back(make_unique<ProfileThread>());
+                current.slot = threads.back().get();
+                current.slot->tid = threads.size() - 1;
+            }
+            current.owner = this;
+        }
+        return *current.slot;
+    }
+
+    // Only between solves, while the workers are idle
+    void reset() {
+        lock_guard<mutex> lock(mtx);
+        epoch = chrono::steady_clock::now();
+        for (auto &thread : threads) {
+            int tid = thread->tid;
+            *thread = ProfileThread();
+            thread->tid = tid;
+        }
+    }
+
+    ProfileThread total() {
+        lock_guard<mutex> lock(mtx);
+        ProfileThread sum;
+        for (auto &thread : threads) {
+            for (int p = 0; p < PHASE_COUNT; p++) {
+                sum.phase_calls[p] += thread->phase_calls[p];
+                sum.phase_ns[p] += thread->phase_ns[p];
+            }
+            for (int c = 0; c < COUNT_COUNTERS; c++) {
+                sum.counters[c] += thread->counters[c];
+            }
+        }
+        return sum;
+    }
+
+    vector<const ProfileThread *> snapshot() {
+        lock_guard<mutex> lock(mtx);
+        vector<const ProfileThread *> result;
+        for (auto &thread : threads) {
+            result.push_back(thread.get());
+        }
+        return result;
+    }
+
+private:
+    mutex mtx;
+    vector<unique_ptr<ProfileThread>> threads;
+    vector<ProfileThread *> idle; // slots of threads that have exited
+};
+
+Profiler profiler;
+
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfilePhase phase) : phase(phase), start(chrono::steady_clock::now()) {}
+
+    ~ProfileScope() {
+        auto end = chrono::steady_clock::now();
+        ProfileThread &thread = profiler.local();
+        long long ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+        thread.phase_calls[phase]++;
+        thread.phase_ns[phase] += ns;
+        if (profiler.tracing && thread.events.size() < Profiler::MAX_TRACE_EVENTS) {
+            long long start_us = chrono::duration_cast<chrono::microseconds>(start - profiler.epoch).count();
+            thread.events.push_back({phase, start_us, ns / 1000});
+        }
+    }
+
+private:
+    ProfilePhase phase;
+    chrono::steady_clock::time_point start;
 };
 
-// Global variables
-Instance instance;
-Node depot;
-vector<Node> pickup_nodes;
-vector<Node> delivery_nodes;
-vector<vector<double>> pheromone;
-HybridParams hybrid_params;
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(phase)
+#define PROFILE_COUNT(counter, n) (profiler.local().counters[counter] += (n))
+#else
+#define PROFILE_SCOPE(phase)
+#define PROFILE_COUNT(counter, n)
+#endif
+
+// Heap allocations made by the calling thread. Build with
+// -DPDPTW_COUNT_ALLOCATIONS (npm run microbench does) to replace the global
+// operator new with one that counts them, so the microbenchmarks can check
+// that a steady-state colony iteration does not allocate. Other builds keep
+// the standard allocator.
+#ifdef PDPTW_COUNT_ALLOCATIONS
+thread_local long long heap_allocations = 0;
+
+void *operator new(size_t size) {
+    heap_allocations++;
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw bad_alloc();
+    return ptr;
+}
+// GCC flags free() on memory from operator new even when both are replaced
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+#pragma GCC diagnostic pop
+#endif
+
+// Why the last solve stopped early, for logs and responses
+const char *stop_reason() {
+    if (stop_requested)
+        return "signal";
+    if (deadline_reached)
+        return "time_limit";
+    return "none";
+}
+
+// Persistent worker threads for the ant colony. The calling thread acts as
+// worker 0. run() hands out tasks in a fixed stripe (task % size() == worker),
+// so with a given seed and thread count every task sees the same RNG stream.
+class WorkerPool {
+public:
+    WorkerPool(int num_threads, unsigned seed) {
+        num_threads = max(1, num_threads);
+        for (int w = 0; w < num_threads; w++) {
+            seed_seq seq{seed, (unsigned)w};
+            rngs.emplace_back(seq);
+        }
+        for (int w = 1; w < num_threads; w++) {
+            threads.emplace_back(&WorkerPool::worker_loop, this, w);
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        cv_start.notify_all();
+        for (thread &t : threads) {
+            t.join();
+        }
+    }
+
+    int size() const { return rngs.size(); }
+
+    mt19937 &rng(int worker) { return rngs[worker]; }
+
+    void reseed(unsigned seed) {
+        for (int w = 0; w < size(); w++) {
+            seed_seq seq{seed, (unsigned)w};
+            rngs[w].seed(seq);
+        }
+    }
+
+    void run(int num_tasks, const function<void(int, int)> &fn) {
+        if (threads.empty()) {
+            for (int task = 0; task < num_tasks; task++) {
+                fn(task, 0);
+            }
+            return;
+        }
+
+        {
+            lock_guard<mutex> lock(mtx);
+            job = &fn;
+            job_tasks = num_tasks;
+            pending = threads.size();
+            generation++;
+        }
+        cv_start.notify_all();
+
+        run_stripe(0);
+
+        unique_lock<mutex> lock(mtx);
+        cv_done.wait(lock, [this] { return pending == 0; });
+        job = nullptr;
+    }
+
+private:
+    vector<mt19937> rngs;
+    vector<thread> threads;
+    mutex mtx;
+    condition_variable cv_start;
+    condition_variable cv_done;
+    const function<void(int, int)> *job = nullptr;
+    int job_tasks = 0;
+    int pending = 0;
+    long long generation = 0;
+    bool stopping = false;
+
+    void run_stripe(int worker) {
+        for (int task = worker; task < job_tasks; task += size()) {
+            (*job)(task, worker);
+        }
+    }
+
+    void worker_loop(int worker) {
+        long long seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lock(mtx);
+                cv_start.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+            }
+
+            run_stripe(worker);
+
+            {
+                lock_guard<mutex> lock(mtx);
+                pending--;
+            }
+            cv_done.notify_one();
+        }
+    }
+};
 
-// Global random generators
-random_device rd_global;
-mt19937 gen_global(rd_global());
-uniform_real_distribution<> dis_global(0.0, 1.0);
+thread_local unique_ptr<WorkerPool> worker_pool;
 
 string trim(const string &str) {
     size_t first = str.find_first_not_of(' ');
@@ -96,17 +833,11 @@ double safe_stod(const string &str, double default_value = 0.0) {
     }
 }
 
-int parse_parameters_from_input(const string &filename) {
-    ifstream file(filename);
-    if (!file.is_open()) {
-        cout << "Error: Cannot open file " << filename << endl;
-        return 3; // default num_routes
-    }
-
-    string first_line;
-    getline(file, first_line);
-    file.close();
-
+// Parses "num_routes ants iterations alpha beta rho tau_max tau_min
+// greedy_bias elite_solutions local_search_prob restart_threshold
+// [regret_k granular_k local_search time_limit_ms islands migration_interval
+// migration_blend cluster_pairs alns_iterations elite_pool]"
+int parse_parameter_line(const string &first_line) {
     int num_routes = 3; // default
 
     // Check if first line contains parameters (starts with numbers)
@@ -126,6 +857,27 @@ int parse_parameters_from_input(const string &filename) {
             hybrid_params.elite_solutions = safe_stoi(params[9], 4);
             hybrid_params.local_search_prob = safe_stod(params[10], 0.7);
             hybrid_params.restart_threshold = safe_stoi(params[11], 9);
+            // Optional trailing fields
+            if (params.size() > 12)
+                hybrid_params.regret_k = max(1, safe_stoi(params[12], 1));
+            if (params.size() > 13)
+                hybrid_params.granular_k = max(0, safe_stoi(params[13], 0));
+            if (params.size() > 14)
+                hybrid_params.local_search = min(2, max(0, safe_stoi(params[14], 1)));
+            if (params.size() > 15)
+                hybrid_params.time_limit_ms = max(0, safe_stoi(params[15], 0));
+            if (params.size() > 16)
+                hybrid_params.islands = max(1, safe_stoi(params[16], 1));
+            if (params.size() > 17)
+                hybrid_params.migration_interval = max(1, safe_stoi(params[17], 5));
+            if (params.size() > 18)
+                hybrid_params.migration_blend = min(1.0, max(0.0, safe_stod(params[18], 0.2)));
+            if (params.size() > 19)
+                hybrid_params.cluster_pairs = max(0, safe_stoi(params[19], 0));
+            if (params.size() > 20)
+                hybrid_params.alns_iterations = max(0, safe_stoi(params[20], 0));
+            if (params.size() > 21)
+                hybrid_params.elite_pool = max(0, safe_stoi(params[21], 0));
 
             cout << "Parameters loaded from file:" << endl;
             cout << "  Routes: " << num_routes << endl;
@@ -140,6 +892,16 @@ int parse_parameters_from_input(const string &filename) {
             cout << "  Elite Solutions: " << hybrid_params.elite_solutions << endl;
             cout << "  Local Search Prob: " << hybrid_params.local_search_prob << endl;
             cout << "  Restart Threshold: " << hybrid_params.restart_threshold << endl;
+            cout << "  Regret K: " << hybrid_params.regret_k << endl;
+            cout << "  Granular K: " << hybrid_params.granular_k << endl;
+            cout << "  Local Search: " << hybrid_params.local_search << endl;
+            cout << "  Time Limit (ms): " << hybrid_params.time_limit_ms << endl;
+            cout << "  Islands: " << hybrid_params.islands << endl;
+            cout << "  Migration Interval: " << hybrid_params.migration_interval << endl;
+            cout << "  Migration Blend: " << hybrid_params.migration_blend << endl;
+            cout << "  Cluster Pairs: " << hybrid_params.cluster_pairs << endl;
+            cout << "  ALNS Iterations: " << hybrid_params.alns_iterations << endl;
+            cout << "  Elite Pool: " << hybrid_params.elite_pool << endl;
         } else {
             cout << "Warning: Not enough parameters in first line, using defaults" << endl;
         }
@@ -150,73 +912,190 @@ int parse_parameters_from_input(const string &filename) {
     return num_routes;
 }
 
-Instance parse_input(const string &filename) {
+int parse_parameters_from_input(const string &filename) {
     ifstream file(filename);
     if (!file.is_open()) {
         cout << "Error: Cannot open file " << filename << endl;
-        exit(1);
+        return 3; // default num_routes
     }
 
-    vector<string> lines;
-    string line;
-    bool first_line = true;
+    string first_line;
+    getline(file, first_line);
+    file.close();
 
-    while (getline(file, line)) {
-        string trimmed = trim(line);
-        if (!trimmed.empty()) {
-            // Skip first line if it contains parameters (starts with numbers)
-            if (first_line && (isdigit(trimmed[0]) || trimmed[0] == '.')) {
-                first_line = false;
-                continue;
-            }
-            lines.push_back(trimmed);
-            first_line = false;
+    return parse_parameter_line(first_line);
+}
+
+// Cursor over an in-memory text buffer. Lines and tokens are returned as views
+// into the buffer, so the text parser touches every byte once.
+struct TextCursor {
+    const char *pos;
+    const char *end;
+
+    static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    // Next non-empty line with surrounding whitespace removed, empty at EOF
+    string_view next_line() {
+        while (pos < end) {
+            const char *line_end = static_cast<const char *>(memchr(pos, '\n', end - pos));
+            if (!line_end)
+                line_end = end;
+            const char *first = pos, *last = line_end;
+            pos = line_end < end ? line_end + 1 : end;
+            while (first < last && is_space(*first))
+                first++;
+            while (last > first && is_space(last[-1]))
+                last--;
+            if (first < last)
+                return string_view(first, last - first);
         }
+        return string_view();
+    }
+};
+
+// Splits the next whitespace-separated token off the front of line
+string_view next_token(string_view &line) {
+    size_t first = 0;
+    while (first < line.size() && TextCursor::is_space(line[first]))
+        first++;
+    size_t last = first;
+    while (last < line.size() && !TextCursor::is_space(line[last]))
+        last++;
+    string_view token = line.substr(first, last - first);
+    line.remove_prefix(last);
+    return token;
+}
+
+// A parameter line has a dozen or more fields; the Li & Lim header line
+// ("vehicles capacity speed") has three
+bool is_parameter_line(string_view line) {
+    int tokens = 0;
+    while (!next_token(line).empty())
+        tokens++;
+    return tokens > 3;
+}
+
+// Same fallbacks as safe_stoi/safe_stod: a leading number is accepted and
+// anything unparsable gives the default
+int parse_int_token(string_view &line, int default_value) {
+    string_view token = next_token(line);
+    int value;
+    auto result = from_chars(token.data(), token.data() + token.size(), value);
+    return result.ec == errc() ? value : default_value;
+}
+
+double parse_double_token(string_view &line, double default_value) {
+    string_view token = next_token(line);
+    double value;
+    auto result = from_chars(token.data(), token.data() + token.size(), value);
+    return result.ec == errc() ? value : default_value;
+}
+
+string_view trim_view(string_view str) {
+    while (!str.empty() && TextCursor::is_space(str.front()))
+        str.remove_prefix(1);
+    while (!str.empty() && TextCursor::is_space(str.back()))
+        str.remove_suffix(1);
+    return str;
+}
+
+// Li & Lim benchmark format: a "vehicles capacity speed" line, then one
+// "id x y demand early late service pickup delivery" line per node, depot
+// first. Travel times are Euclidean distances rounded to the nearest integer,
+// so costs are close to, not equal to, the published real-valued ones.
+Instance parse_li_lim_text(string_view text) {
+    TextCursor cursor{text.data(), text.data() + text.size()};
+    string_view line = cursor.next_line();
+
+    // Skip a parameter line put in front of the header
+    if (is_parameter_line(line))
+        line = cursor.next_line();
+
+    Instance inst;
+    inst.name = "Unknown";
+    inst.location = "Unknown";
+    parse_int_token(line, 0); // vehicle count, minimized by the solver anyway
+    inst.capacity = parse_int_token(line, 100);
+
+    vector<Node> nodes;
+    while (!(line = cursor.next_line()).empty()) {
+        Node node;
+        node.id = parse_int_token(line, nodes.size());
+        node.lat = parse_double_token(line, 0.0);
+        node.lon = parse_double_token(line, 0.0);
+        node.demand = parse_int_token(line, 0);
+        node.early_time = parse_int_token(line, 0);
+        node.late_time = parse_int_token(line, 1440);
+        node.service_duration = parse_int_token(line, 0);
+        node.pickup_pair = parse_int_token(line, -1);
+        node.delivery_pair = parse_int_token(line, -1);
+        nodes.push_back(node);
+    }
+
+    int size = nodes.size();
+    Matrix<int> travel_times(size, size, 0);
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            travel_times[i][j] = (int)lround(hypot(nodes[i].lat - nodes[j].lat, nodes[i].lon - nodes[j].lon));
+        }
+    }
+
+    inst.size = size;
+    inst.route_time = size > 0 ? nodes[0].late_time : 1440;
+    inst.nodes = move(nodes);
+    inst.travel_times = move(travel_times);
+    return inst;
+}
+
+Instance parse_instance_text(string_view text) {
+    // Sartori & Buriol files have a NODES section, Li & Lim files do not
+    if (text.find("NODES") == string_view::npos)
+        return parse_li_lim_text(text);
+
+    TextCursor cursor{text.data(), text.data() + text.size()};
+    string_view line = cursor.next_line();
+
+    // Skip first line if it contains parameters (starts with numbers)
+    if (!line.empty() && (isdigit((unsigned char)line[0]) || line[0] == '.')) {
+        line = cursor.next_line();
     }
-    file.close();
 
     map<string, string> info;
-    int i = 0;
-    while (i < lines.size() && lines[i] != "NODES") {
-        if (lines[i].find(':') != string::npos) {
-            size_t pos = lines[i].find(':');
-            string key = trim(lines[i].substr(0, pos));
-            string value = trim(lines[i].substr(pos + 1));
-            info[key] = value;
+    while (!line.empty() && line != "NODES") {
+        size_t colon = line.find(':');
+        if (colon != string_view::npos) {
+            info[string(trim_view(line.substr(0, colon)))] = string(trim_view(line.substr(colon + 1)));
         }
-        i++;
+        line = cursor.next_line();
     }
 
-    i++; // Skip "NODES" line
-    vector<Node> nodes;
     int size = safe_stoi(info["SIZE"], 0);
+    vector<Node> nodes(size);
 
     for (int j = 0; j < size; j++) {
-        vector<string> parts = split(lines[i + j], ' ');
-        Node node;
-        node.id = safe_stoi(parts[0], j);
-        node.lat = safe_stod(parts[1], 0.0);
-        node.lon = safe_stod(parts[2], 0.0);
-        node.demand = safe_stoi(parts[3], 0);
-        node.early_time = safe_stoi(parts[4], 0);
-        node.late_time = safe_stoi(parts[5], 1440);
-        node.service_duration = safe_stoi(parts[6], 0);
-        node.pickup_pair = safe_stoi(parts[7], -1);
-        node.delivery_pair = safe_stoi(parts[8], -1);
-        nodes.push_back(node);
+        line = cursor.next_line();
+        Node &node = nodes[j];
+        node.id = parse_int_token(line, j);
+        node.lat = parse_double_token(line, 0.0);
+        node.lon = parse_double_token(line, 0.0);
+        node.demand = parse_int_token(line, 0);
+        node.early_time = parse_int_token(line, 0);
+        node.late_time = parse_int_token(line, 1440);
+        node.service_duration = parse_int_token(line, 0);
+        node.pickup_pair = parse_int_token(line, -1);
+        node.delivery_pair = parse_int_token(line, -1);
     }
 
-    i += size;
-    while (i < lines.size() && lines[i] != "EDGES") {
-        i++;
-    }
-    i++; // Skip "EDGES" line
+    do {
+        line = cursor.next_line();
+    } while (!line.empty() && line != "EDGES");
 
-    vector<vector<int>> travel_times(size, vector<int>(size, 0));
+    Matrix<int> travel_times(size, size, 0);
     for (int j = 0; j < size; j++) {
-        vector<string> row = split(lines[i + j], ' ');
+        line = cursor.next_line();
+        int *row = travel_times[j];
         for (int k = 0; k < size; k++) {
-            travel_times[j][k] = safe_stoi(row[k], 9999);
+            row[k] = parse_int_token(line, 9999);
         }
     }
 
@@ -225,54 +1104,259 @@ Instance parse_input(const string &filename) {
     inst.location = info.count("LOCATION") ? info["LOCATION"] : "Unknown";
     inst.size = size;
     inst.capacity = info.count("CAPACITY") ? safe_stoi(info["CAPACITY"], 100) : 100;
-    inst.route_time = info.count("ROUTE-TIME") ? safe_stoi(info["ROUTE-TIME"], 1440) : 1440;
+    // Without a ROUTE-TIME line the depot window is the only limit
+    int horizon = size > 0 ? nodes[0].late_time : 1440;
+    inst.route_time = info.count("ROUTE-TIME") ? safe_stoi(info["ROUTE-TIME"], horizon) : horizon;
     inst.nodes = nodes;
-    inst.travel_times = travel_times;
+    inst.travel_times = move(travel_times);
     return inst;
 }
 
-bool is_feasible_route(const vector<int> &route) {
-    if (route.empty())
-        return true;
+bool parse_input(const string &filename, Instance &inst, string &error) {
+    ifstream file(filename, ios::binary);
+    if (!file.is_open()) {
+        error = "Cannot open file " + filename;
+        return false;
+    }
 
-    int current_time = 0;
-    int current_load = 0;
-    vector<bool> visited_pickup(instance.size, false);
+    string buffer;
+    file.seekg(0, ios::end);
+    buffer.resize(file.tellg());
+    file.seekg(0, ios::beg);
+    file.read(&buffer[0], buffer.size());
+    file.close();
 
-    for (int i = 0; i < route.size(); i++) {
-        int node_id = route[i];
-        const Node &node = instance.nodes[node_id];
+    inst = parse_instance_text(buffer);
+    return true;
+}
 
-        if (i == 0) {
-            current_time += instance.travel_times[0][node_id];
-        } else {
-            current_time += instance.travel_times[route[i - 1]][node_id];
-        }
+// Binary instance file (little-endian): header, node table, then the travel
+// time matrix as int32 rows padded exactly like Matrix<int>, starting on a
+// 64-byte boundary. The matrix is mapped and used in place.
+const char BINARY_INSTANCE_MAGIC[8] = {'P', 'D', 'P', 'T', 'W', 'B', 'I', 'N'};
+const uint32_t BINARY_INSTANCE_VERSION = 1;
+
+struct BinaryInstanceHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t size;
+    int32_t capacity;
+    int32_t route_time;
+    int32_t stride;
+    int32_t reserved;
+    uint64_t nodes_offset;
+    uint64_t matrix_offset;
+    char name[64];
+    char location[64];
+};
 
-        if (current_time > node.late_time)
-            return false;
+struct BinaryNode {
+    int32_t id;
+    int32_t demand;
+    int32_t early_time;
+    int32_t late_time;
+    int32_t service_duration;
+    int32_t pickup_pair;
+    int32_t delivery_pair;
+    int32_t reserved;
+    double lat;
+    double lon;
+};
 
-        current_time = max(current_time, node.early_time);
-        current_time += node.service_duration;
+static_assert(sizeof(BinaryInstanceHeader) == 176, "binary header layout changed");
+static_assert(sizeof(BinaryNode) == 48, "binary node layout changed");
 
-        if (node.is_delivery() && !visited_pickup[node.pickup_pair]) {
+bool is_binary_instance(const string &filename) {
+    ifstream file(filename, ios::binary);
+    char magic[8] = {};
+    file.read(magic, sizeof(magic));
+    return file.gcount() == sizeof(magic) && memcmp(magic, BINARY_INSTANCE_MAGIC, sizeof(magic)) == 0;
+}
+
+void write_binary_instance(const string &filename, const Instance &inst) {
+    BinaryInstanceHeader header = {};
+    memcpy(header.magic, BINARY_INSTANCE_MAGIC, sizeof(header.magic));
+    header.version = BINARY_INSTANCE_VERSION;
+    header.size = inst.size;
+    header.capacity = inst.capacity;
+    header.route_time = inst.route_time;
+    header.stride = Matrix<int>::padded_stride(inst.size);
+    header.nodes_offset = sizeof(BinaryInstanceHeader);
+    header.matrix_offset = (header.nodes_offset + inst.size * sizeof(BinaryNode) + 63) / 64 * 64;
+    strncpy(header.name, inst.name.c_str(), sizeof(header.name) - 1);
+    strncpy(header.location, inst.location.c_str(), sizeof(header.location) - 1);
+
+    ofstream file(filename, ios::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const Node &node : inst.nodes) {
+        BinaryNode bn = {node.id, node.demand, node.early_time, node.late_time, node.service_duration,
+                         node.pickup_pair, node.delivery_pair, 0, node.lat, node.lon};
+        file.write(reinterpret_cast<const char *>(&bn), sizeof(bn));
+    }
+
+    vector<char> padding(header.matrix_offset - (header.nodes_offset + inst.size * sizeof(BinaryNode)), 0);
+    file.write(padding.data(), padding.size());
+    for (int i = 0; i < inst.size; i++) {
+        file.write(reinterpret_cast<const char *>(inst.travel_times[i]), header.stride * sizeof(int32_t));
+    }
+}
+
+#ifndef _WIN32
+struct MappedFile {
+    void *addr = MAP_FAILED;
+    size_t length = 0;
+
+    ~MappedFile() {
+        if (addr != MAP_FAILED)
+            munmap(addr, length);
+    }
+};
+#endif
+
+bool load_binary_instance(const string &filename, Instance &inst, string &error) {
+    shared_ptr<void> backing;
+    char *data = nullptr;
+    size_t length = 0;
+
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0)
+            close(fd);
+        error = "Cannot open file " + filename;
+        return false;
+    }
+    auto mapped = make_shared<MappedFile>();
+    mapped->length = st.st_size;
+    // Read-only mapping: the matrix is never written, and pages stay shared
+    // with the page cache
+    mapped->addr = mmap(nullptr, mapped->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped->addr == MAP_FAILED) {
+        error = "Cannot map file " + filename;
+        return false;
+    }
+    data = static_cast<char *>(mapped->addr);
+    length = mapped->length;
+    backing = mapped;
+#else
+    ifstream file(filename, ios::binary | ios::ate);
+    if (!file.is_open()) {
+        error = "Cannot open file " + filename;
+        return false;
+    }
+    length = file.tellg();
+    auto buffer = shared_ptr<char>(static_cast<char *>(::operator new(length, align_val_t(64))),
+                                   [](char *p) { ::operator delete(p, align_val_t(64)); });
+    file.seekg(0);
+    file.read(buffer.get(), length);
+    data = buffer.get();
+    backing = buffer;
+#endif
+
+    // Both regions must lie inside the file; offsets are compared before
+    // subtracting so a huge one cannot wrap around
+    BinaryInstanceHeader header = {};
+    memcpy(&header, data, min(length, sizeof(header)));
+    if (length < sizeof(header) || header.version != BINARY_INSTANCE_VERSION || header.size < 0 ||
+        header.stride != Matrix<int>::padded_stride(header.size) || header.matrix_offset % 64 != 0 ||
+        header.nodes_offset > length ||
+        (length - header.nodes_offset) / sizeof(BinaryNode) < (uint64_t)header.size ||
+        header.matrix_offset > length ||
+        (length - header.matrix_offset) / sizeof(int32_t) / max(1, header.stride) < (uint64_t)header.size) {
+        error = "Corrupt binary instance " + filename;
+        return false;
+    }
+
+    inst = Instance();
+    inst.name = string(header.name, strnlen(header.name, sizeof(header.name)));
+    inst.location = string(header.location, strnlen(header.location, sizeof(header.location)));
+    inst.size = header.size;
+    inst.capacity = header.capacity;
+    inst.route_time = header.route_time;
+    inst.nodes.resize(header.size);
+    for (int i = 0; i < header.size; i++) {
+        BinaryNode bn;
+        memcpy(&bn, data + header.nodes_offset + i * sizeof(BinaryNode), sizeof(bn));
+        inst.nodes[i] = {bn.id, bn.lat, bn.lon, bn.demand, bn.early_time, bn.late_time,
+                         bn.service_duration, bn.pickup_pair, bn.delivery_pair};
+    }
+    inst.travel_times.view(reinterpret_cast<int *>(data + header.matrix_offset), header.size, header.size, backing);
+    return true;
+}
+
+// Node ids and pair references are used as node indices everywhere, so ids
+// must match positions and every pickup and delivery must name each other
+bool check_instance(const Instance &inst, string &error) {
+    for (int i = 0; i < inst.size; i++) {
+        const Node &node = inst.nodes[i];
+        if (node.id != i) {
+            error = "Node at position " + to_string(i) + " has id " + to_string(node.id);
             return false;
         }
-
-        if (node.is_pickup()) {
-            visited_pickup[node_id] = true;
+        if (node.pickup_pair < -1 || node.pickup_pair >= inst.size || node.delivery_pair < -1 ||
+            node.delivery_pair >= inst.size) {
+            error = "Node " + to_string(i) + " references a pair outside the instance";
+            return false;
         }
-
-        current_load += node.demand;
-        if (current_load > instance.capacity || current_load < 0) {
+        if (i == 0 || (!node.is_pickup() && !node.is_delivery()))
+            continue;
+        int partner = node.is_pickup() ? node.delivery_pair : node.pickup_pair;
+        bool paired = partner > 0 && (node.is_pickup() ? inst.nodes[partner].pickup_pair == i
+                                                       : inst.nodes[partner].delivery_pair == i);
+        if (!paired) {
+            error = "Node " + to_string(i) + " and its pair do not reference each other";
             return false;
         }
     }
+    return true;
+}
 
-    int return_time = current_time + instance.travel_times[route.back()][0];
-    if (return_time > instance.nodes[0].late_time)
+// Reports failures through error instead of exiting, so a daemon survives a bad file
+bool load_instance(const string &filename, Instance &inst, string &error) {
+    bool loaded = is_binary_instance(filename) ? load_binary_instance(filename, inst, error)
+                                               : parse_input(filename, inst, error);
+    return loaded && check_instance(inst, error);
+}
+
+// Node count from the header alone: the binary header, the SIZE line before
+// NODES, or for Li & Lim files the node lines after the vehicle line
+bool read_instance_size(const string &filename, int &size, string &error) {
+    ifstream file(filename, ios::binary);
+    if (!file.is_open()) {
+        error = "Cannot open file " + filename;
         return false;
+    }
+    if (is_binary_instance(filename)) {
+        BinaryInstanceHeader header = {};
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (file.gcount() != sizeof(header) || header.version != BINARY_INSTANCE_VERSION || header.size < 0) {
+            error = "Corrupt binary instance " + filename;
+            return false;
+        }
+        size = header.size;
+        return true;
+    }
 
+    string line;
+    int lines = 0;
+    bool parameter_line = false;
+    size = 0;
+    while (getline(file, line)) {
+        string_view view = trim_view(line);
+        if (view == "NODES")
+            return true;
+        size_t colon = view.find(':');
+        if (colon != string_view::npos && trim_view(view.substr(0, colon)) == "SIZE")
+            size = safe_stoi(string(trim_view(view.substr(colon + 1))), 0);
+        if (view.empty())
+            continue;
+        if (lines++ == 0)
+            parameter_line = is_parameter_line(view);
+    }
+    // No NODES section: a Li & Lim file, maybe behind a parameter line
+    size = max(0, lines - 1 - parameter_line);
     return true;
 }
 
@@ -289,523 +1373,4920 @@ int calculate_route_cost(const vector<int> &route) {
     return total_time;
 }
 
-// Exact same feasibility check as pure greedy
-bool is_feasible_insertion(const vector<int> &route, int pickup_id, int delivery_id, int pickup_pos, int delivery_pos) {
-    if (pickup_pos > delivery_pos) {
-        return false;
+// Granular neighbourhoods: for each node the k most related nodes, ranked by
+// travel time plus the waiting the time windows force even when leaving as
+// late as possible. Arcs whose windows cannot be chained are never related.
+// Two nodes are neighbours when either appears in the other's list.
+struct CandidateLists {
+    int k = 0; // 0 = disabled
+    int n = 0;
+    vector<vector<int>> lists;
+    vector<uint64_t> bits;
+
+    bool enabled() const { return k > 0; }
+
+    bool contains(int i, int j) const {
+        size_t b = (size_t)i * n + j;
+        return bits[b >> 6] >> (b & 63) & 1;
     }
 
-    vector<int> new_route = route;
-    new_route.insert(new_route.begin() + delivery_pos, delivery_id);
-    new_route.insert(new_route.begin() + pickup_pos, pickup_id);
-
-    return is_feasible_route(new_route);
-}
-
-// Pure greedy insertion - exactly like PDPTW_GREEDY_INSERTION.cpp
-vector<vector<int>> pure_greedy_insertion(int num_routes) {
-    vector<vector<int>> routes(num_routes);
-    set<int> unvisited_pairs;
+    void add(int i, int j) {
+        size_t b = (size_t)i * n + j;
+        bits[b >> 6] |= 1ULL << (b & 63);
+    }
+};
 
-    for (const Node &node : pickup_nodes) {
-        unvisited_pairs.insert(node.id);
+thread_local CandidateLists candidates;
+
+// Arcs that can appear in a feasible route, one bit per ordered node pair;
+// node 0 stands for the route start as the tail of an arc and for the route
+// end as its head. An arc is ruled out when leaving its tail as early as
+// possible still misses the head's window, when it starts a route with a
+// delivery, ends one with a pickup or runs from a delivery to its own pickup,
+// or when the goods on board around it exceed the capacity. Every rule is
+// exact, so the filter never rejects a feasible route.
+struct ArcFilter {
+    int n = 0;
+    vector<uint64_t> bits;
+    long long eliminated = 0;
+    int windows_tightened = 0;
+
+    bool compatible(int i, int j) const {
+        size_t b = (size_t)i * n + j;
+        return bits[b >> 6] >> (b & 63) & 1;
     }
+};
 
-    while (!unvisited_pairs.empty()) {
-        struct GreedyInsertion {
-            int pickup_id;
-            int delivery_id;
-            int route_idx;
-            int pickup_pos;
-            int delivery_pos;
-            double efficiency_score;
-        };
+thread_local ArcFilter arcs;
 
-        GreedyInsertion best_insertion;
-        best_insertion.efficiency_score = DBL_MAX;
-        bool found_insertion = false;
+// a = nodes[from], b = nodes[to], t = travel time of the arc
+inline bool arc_possible(int from, int to, const Node &a, const Node &b, int t) {
+    if (from == to)
+        return false;
+    int leave = from == 0 ? 0 : a.early_time + a.service_duration;
+    if (leave + t > b.late_time)
+        return false;
+    if (from == 0 || to == 0)
+        return from == 0 ? !b.is_delivery() : !a.is_pickup();
+    if (a.is_delivery() && a.pickup_pair == to)
+        return false;
 
-        for (int pickup_id : unvisited_pairs) {
-            int delivery_id = instance.nodes[pickup_id].delivery_pair;
+    // Goods on board just before from, across the arc and just after to
+    int own = a.is_pickup() && a.delivery_pair == to ? a.demand : 0;
+    int before = (a.is_delivery() ? -a.demand : 0) + (b.is_delivery() ? -b.demand : 0);
+    int across = (a.is_pickup() ? a.demand : 0) + (b.is_delivery() ? -b.demand : 0) - own;
+    int after = (a.is_pickup() ? a.demand : 0) - own + (b.is_pickup() ? b.demand : 0);
+    return max(before, max(across, after)) <= instance.capacity;
+}
 
-            for (int r = 0; r < num_routes; r++) {
-                for (int p_pos = 0; p_pos <= routes[r].size(); p_pos++) {
-                    for (int d_pos = p_pos; d_pos <= routes[r].size(); d_pos++) {
-                        if (is_feasible_insertion(routes[r], pickup_id, delivery_id, p_pos, d_pos)) {
-                            int old_cost = calculate_route_cost(routes[r]);
-
-                            vector<int> new_route = routes[r];
-                            new_route.insert(new_route.begin() + d_pos, delivery_id);
-                            new_route.insert(new_route.begin() + p_pos, pickup_id);
-
-                            int new_cost = calculate_route_cost(new_route);
-                            int cost_increase = new_cost - old_cost;
-
-                            // Pure greedy logic - minimal cost increase
-                            double efficiency_score = cost_increase;
-
-                            if (!found_insertion || efficiency_score < best_insertion.efficiency_score) {
-                                best_insertion.pickup_id = pickup_id;
-                                best_insertion.delivery_id = delivery_id;
-                                best_insertion.route_idx = r;
-                                best_insertion.pickup_pos = p_pos;
-                                best_insertion.delivery_pos = d_pos;
-                                best_insertion.efficiency_score = efficiency_score;
-                                found_insertion = true;
-                            }
-                        }
-                    }
+// Builds arcs and tightens the time windows in instance.nodes to what the
+// compatible arcs allow: a node is never reached before the earliest arrival
+// over its possible predecessors, and must be left in time for at least one
+// possible successor. Narrower windows rule out more arcs, so the sweep
+// repeats while windows change, up to three times.
+void build_arc_filter() {
+    int n = instance.size;
+    arcs = ArcFilter();
+    arcs.n = n;
+    vector<char> tightened(n, 0);
+    vector<int> earliest(n), latest(n);
+
+    for (int pass = 0; pass < 3; pass++) {
+        arcs.bits.assign(((size_t)n * n + 63) / 64, 0);
+        arcs.eliminated = 0;
+        fill(earliest.begin(), earliest.end(), INT_MAX);
+        fill(latest.begin(), latest.end(), INT_MIN);
+        for (int i = 0; i < n; i++) {
+            const Node *nodes = instance.nodes.data();
+            const Node &from = nodes[i];
+            int leave = i == 0 ? 0 : from.early_time + from.service_duration;
+            const int *times = instance.travel_times[i];
+            for (int j = 0; j < n; j++) {
+                if (!arc_possible(i, j, from, nodes[j], times[j])) {
+                    arcs.eliminated += i != j;
+                    continue;
                 }
+                size_t b = (size_t)i * n + j;
+                arcs.bits[b >> 6] |= 1ULL << (b & 63);
+                earliest[j] = min(earliest[j], leave + times[j]);
+                latest[i] = max(latest[i], nodes[j].late_time - from.service_duration - times[j]);
             }
         }
 
-        if (!found_insertion) {
-            break;
+        bool changed = false;
+        for (int k = 1; k < n; k++) {
+            Node &node = instance.nodes[k];
+            // A node no route can serve keeps its window
+            if (earliest[k] > node.early_time && earliest[k] <= node.late_time) {
+                node.early_time = earliest[k];
+                tightened[k] = changed = true;
+            }
+            if (latest[k] < node.late_time && latest[k] >= node.early_time) {
+                node.late_time = latest[k];
+                tightened[k] = changed = true;
+            }
         }
-
-        routes[best_insertion.route_idx].insert(
-            routes[best_insertion.route_idx].begin() + best_insertion.delivery_pos,
-            best_insertion.delivery_id);
-        routes[best_insertion.route_idx].insert(
-            routes[best_insertion.route_idx].begin() + best_insertion.pickup_pos,
-            best_insertion.pickup_id);
-
-        unvisited_pairs.erase(best_insertion.pickup_id);
+        if (!changed)
+            break;
     }
+    arcs.windows_tightened = count(tightened.begin(), tightened.end(), 1);
+}
 
-    return routes;
+int arc_relatedness(int from, int to) {
+    const Node &a = instance.nodes[from];
+    const Node &b = instance.nodes[to];
+    int t = instance.travel_times[from][to];
+    if (!arcs.compatible(from, to))
+        return INT_MAX;
+    return t + max(0, b.early_time - (a.late_time + a.service_duration + t));
 }
 
-void initialize_pheromone() {
+// The k nodes most related to each node, most related first
+vector<vector<int>> related_node_lists(int k) {
     int n = instance.size;
-    pheromone.assign(n, vector<double>(n, 1.0));
+    vector<vector<int>> lists(n);
+    vector<pair<int, int>> scored;
+    for (int i = 0; i < n; i++) {
+        scored.clear();
+        for (int j = 0; j < n; j++) {
+            int score = j == i ? INT_MAX : min(arc_relatedness(i, j), arc_relatedness(j, i));
+            if (score != INT_MAX)
+                scored.push_back({score, j});
+        }
+        int take = min<int>(k, scored.size());
+        partial_sort(scored.begin(), scored.begin() + take, scored.end());
+        for (int h = 0; h < take; h++)
+            lists[i].push_back(scored[h].second);
+    }
+    return lists;
+}
 
-    // Initialize with greedy solution paths
-    vector<vector<int>> greedy_routes = pure_greedy_insertion(3);
+void build_candidate_lists(int k) {
+    candidates = CandidateLists();
+    candidates.k = k;
+    if (k <= 0)
+        return;
 
-    for (const auto &route : greedy_routes) {
-        if (!route.empty()) {
-            pheromone[0][route[0]] += 2.0;
-            for (int i = 0; i < route.size() - 1; i++) {
-                pheromone[route[i]][route[i + 1]] += 2.0;
-            }
-            pheromone[route.back()][0] += 2.0;
+    int n = instance.size;
+    candidates.n = n;
+    candidates.lists = related_node_lists(k);
+    candidates.bits.assign(((size_t)n * n + 63) / 64, 0);
+    for (int i = 0; i < n; i++) {
+        for (int j : candidates.lists[i]) {
+            candidates.add(i, j);
+            candidates.add(j, i);
         }
     }
 }
 
-struct HybridSolution {
-    vector<vector<int>> routes;
-    int total_cost;
-    int used_routes;
+// Time-window and load summary of a contiguous node sequence. Starting the
+// segment at time t is feasible iff t <= latest, and the vehicle then leaves
+// the last node at max(t, earliest) + duration. Two summaries concatenate in
+// O(1), which lets insertion moves be checked without rebuilding the route.
+const int TIME_INF = 1000000000;
+
+struct RouteSegment {
+    int first;
+    int last;
+    int earliest;
+    int latest;
+    int duration;
+    int travel;
+    int load;
+    int max_load;
+    int min_load;
+    bool feasible;
+};
 
-    HybridSolution(int num_routes) : routes(num_routes), total_cost(0), used_routes(0) {}
+RouteSegment node_segment(int node_id) {
+    const Node &node = instance.nodes[node_id];
+    RouteSegment seg;
+    seg.first = seg.last = node_id;
+    seg.earliest = node.early_time;
+    seg.latest = node.late_time;
+    seg.duration = node.service_duration;
+    seg.travel = 0;
+    seg.load = seg.max_load = seg.min_load = node.demand;
+    seg.feasible = node.early_time <= node.late_time;
+    return seg;
+}
 
-    void calculate_cost() {
-        total_cost = 0;
-        used_routes = 0;
-        for (const auto &route : routes) {
-            if (!route.empty()) {
-                total_cost += calculate_route_cost(route);
-                used_routes++;
-            }
-        }
-    }
+// Vehicles leave the depot at time 0 with an empty load
+RouteSegment depot_start_segment() {
+    RouteSegment seg;
+    seg.first = seg.last = 0;
+    seg.earliest = 0;
+    seg.latest = TIME_INF;
+    seg.duration = 0;
+    seg.travel = 0;
+    seg.load = seg.max_load = seg.min_load = 0;
+    seg.feasible = true;
+    return seg;
+}
 
-    bool operator<(const HybridSolution &other) const {
-        if (used_routes != other.used_routes) {
-            return used_routes < other.used_routes;
-        }
-        return total_cost < other.total_cost;
-    }
+RouteSegment concat_segments(const RouteSegment &a, const RouteSegment &b) {
+    int t = instance.travel_times[a.last][b.first];
+    int shift = a.duration + t;
+
+    RouteSegment seg;
+    seg.first = a.first;
+    seg.last = b.last;
+    seg.feasible = a.feasible && b.feasible && a.earliest + shift <= b.latest;
+    seg.earliest = max(a.earliest, b.earliest - shift);
+    seg.latest = min(a.latest, b.latest - shift);
+    seg.duration = shift + b.duration;
+    seg.travel = a.travel + t + b.travel;
+    seg.load = a.load + b.load;
+    seg.max_load = max(a.max_load, a.load + b.max_load);
+    seg.min_load = min(a.min_load, a.load + b.min_load);
+    return seg;
+}
+
+// Which constraints of the loaded instance can bind. The feasibility kernels
+// are templated on a ConstraintPolicy, so a check that can never fail on this
+// instance is compiled out: the capacity when all pickups fit in one vehicle
+// together, service times when no node has any, and the route duration limit
+// (ROUTE-TIME) when the depot closes before a route could exceed it.
+struct ConstraintProfile {
+    bool capacity = true;
+    bool service_times = true;
+    bool route_duration = true;
 };
 
-// Simple 2-opt local search
-HybridSolution local_search_2opt(const HybridSolution &solution) {
-    HybridSolution improved = solution;
+thread_local ConstraintProfile constraint_profile;
 
-    for (int r = 0; r < improved.routes.size(); r++) {
-        vector<int> &route = improved.routes[r];
-        if (route.size() < 4)
-            continue;
+template <bool Capacity, bool ServiceTimes, bool RouteDuration>
+struct ConstraintPolicy {
+    static constexpr bool capacity = Capacity;
+    static constexpr bool service_times = ServiceTimes;
+    static constexpr bool route_duration = RouteDuration;
+};
 
-        bool improved_route = true;
-        while (improved_route) {
-            improved_route = false;
-            int current_cost = calculate_route_cost(route);
+// Checks everything; right for any instance
+using GenericPolicy = ConstraintPolicy<true, true, true>;
 
-            for (int i = 0; i < route.size() - 3; i++) {
-                for (int j = i + 2; j < route.size() - 1; j++) {
-                    vector<int> new_route = route;
-                    reverse(new_route.begin() + i + 1, new_route.begin() + j + 1);
+ConstraintProfile analyze_constraints(const Instance &inst) {
+    ConstraintProfile profile;
+    long long total_pickup = 0;
+    bool service = false;
+    for (const Node &node : inst.nodes) {
+        total_pickup += max(0, node.demand);
+        service = service || node.service_duration != 0;
+    }
+    profile.capacity = total_pickup > inst.capacity;
+    profile.service_times = service;
+    // Routes leave at time 0 or later and are back by the depot's late time
+    profile.route_duration = inst.size > 0 && inst.route_time < inst.nodes[0].late_time;
+    return profile;
+}
 
-                    if (is_feasible_route(new_route)) {
-                        int new_cost = calculate_route_cost(new_route);
-                        if (new_cost < current_cost) {
-                            route = new_route;
-                            current_cost = new_cost;
-                            improved_route = true;
-                            break;
-                        }
-                    }
-                }
-                if (improved_route)
-                    break;
-            }
-        }
+string describe_constraints(const ConstraintProfile &profile) {
+    string text;
+    for (auto [on, name] : {pair<bool, const char *>{profile.capacity, "capacity"},
+                            {profile.service_times, "service times"},
+                            {profile.route_duration, "route duration"}}) {
+        if (on)
+            text += (text.empty() ? "" : ", ") + string(name);
     }
+    return text.empty() ? "time windows only" : text;
+}
 
-    improved.calculate_cost();
-    return improved;
+// Calls f with the policy instantiation matching constraint_profile
+template <class F>
+auto with_constraint_policy(F &&f) {
+    const ConstraintProfile &p = constraint_profile;
+    switch (p.capacity << 2 | p.service_times << 1 | p.route_duration) {
+    case 0: return f(ConstraintPolicy<false, false, false>());
+    case 1: return f(ConstraintPolicy<false, false, true>());
+    case 2: return f(ConstraintPolicy<false, true, false>());
+    case 3: return f(ConstraintPolicy<false, true, true>());
+    case 4: return f(ConstraintPolicy<true, false, false>());
+    case 5: return f(ConstraintPolicy<true, false, true>());
+    case 6: return f(ConstraintPolicy<true, true, false>());
+    default: return f(GenericPolicy());
+    }
 }
 
-class HybridAnt {
-private:
-    random_device rd;
-    mt19937 gen;
-    uniform_real_distribution<> dis;
+// Shortest time a route spends away from the depot: leaving as late as its
+// windows allow cuts all waiting except what they force
+inline int min_route_duration(const RouteSegment &seg) { return seg.duration + max(0, seg.earliest - seg.latest); }
 
-public:
-    HybridAnt() : gen(rd()), dis(0.0, 1.0) {}
+// A full depot-to-depot segment started at time 0
+template <class Policy = GenericPolicy>
+inline bool is_feasible_segment(const RouteSegment &seg) {
+    if (!seg.feasible || seg.latest < 0 || seg.min_load < 0)
+        return false;
+    if (Policy::capacity && seg.max_load > instance.capacity)
+        return false;
+    return !Policy::route_duration || min_route_duration(seg) <= instance.route_time;
+}
 
-    HybridSolution construct_solution(int num_routes) {
-        HybridSolution solution(num_routes);
-        set<int> unvisited_pairs;
+// Pickups seen by the running is_feasible_route call are marked with its
+// stamp, so the marks need no clearing between calls
+thread_local vector<unsigned> pickup_visit_stamp;
+thread_local unsigned visit_stamp = 0;
 
-        for (const Node &node : pickup_nodes) {
-            unvisited_pairs.insert(node.id);
-        }
+template <class Policy>
+bool feasible_route_kernel(const vector<int> &route) {
+    if (route.empty())
+        return true;
 
-        while (!unvisited_pairs.empty()) {
-            int selected_pickup;
+    int current_time = 0;
+    int current_load = 0;
+    if (pickup_visit_stamp.size() < instance.size || ++visit_stamp == 0) {
+        pickup_visit_stamp.assign(max((size_t)instance.size, pickup_visit_stamp.size()), 0);
+        visit_stamp = 1;
+    }
 
-            // Very high probability of greedy selection
-            if (dis(gen) < hybrid_params.greedy_bias) {
-                selected_pickup = select_greedy_pickup(unvisited_pairs, solution);
-            } else {
-                selected_pickup = select_aco_pickup(unvisited_pairs);
-            }
+    for (int i = 0; i < route.size(); i++) {
+        int node_id = route[i];
+        const Node &node = instance.nodes[node_id];
 
-            if (selected_pickup == -1)
-                break;
+        if (i == 0) {
+            current_time += instance.travel_times[0][node_id];
+        } else {
+            current_time += instance.travel_times[route[i - 1]][node_id];
+        }
 
-            int delivery_id = instance.nodes[selected_pickup].delivery_pair;
-            auto best_insertion = find_best_insertion(solution, selected_pickup, delivery_id);
+        if (current_time > node.late_time)
+            return false;
 
-            if (best_insertion.first != -1) {
-                int route_idx = best_insertion.first;
-                auto positions = best_insertion.second;
+        current_time = max(current_time, node.early_time);
+        if (Policy::service_times)
+            current_time += node.service_duration;
 
-                solution.routes[route_idx].insert(
-                    solution.routes[route_idx].begin() + positions.second, delivery_id);
-                solution.routes[route_idx].insert(
-                    solution.routes[route_idx].begin() + positions.first, selected_pickup);
+        if (node.is_delivery() && pickup_visit_stamp[node.pickup_pair] != visit_stamp) {
+            return false;
+        }
 
-                unvisited_pairs.erase(selected_pickup);
-            } else {
-                break;
-            }
+        if (node.is_pickup()) {
+            pickup_visit_stamp[node_id] = visit_stamp;
         }
 
-        solution.calculate_cost();
-        return solution;
+        current_load += node.demand;
+        if ((Policy::capacity && current_load > instance.capacity) || current_load < 0) {
+            return false;
+        }
     }
 
-private:
-    int select_greedy_pickup(const set<int> &candidates, const HybridSolution &current_solution) {
-        if (candidates.empty())
-            return -1;
-
-        int best_pickup = -1;
-        int best_cost_increase = INT_MAX;
-
-        for (int pickup_id : candidates) {
-            int delivery_id = instance.nodes[pickup_id].delivery_pair;
-            int min_cost_increase = INT_MAX;
+    int return_time = current_time + instance.travel_times[route.back()][0];
+    if (return_time > instance.nodes[0].late_time)
+        return false;
 
-            for (int r = 0; r < current_solution.routes.size(); r++) {
-                const vector<int> &route = current_solution.routes[r];
+    // The simulation leaves at time 0; the duration limit allows for a later start
+    if (Policy::route_duration) {
+        RouteSegment seg = depot_start_segment();
+        for (int node_id : route)
+            seg = concat_segments(seg, node_segment(node_id));
+        if (min_route_duration(concat_segments(seg, node_segment(0))) > instance.route_time)
+            return false;
+    }
 
-                for (int p_pos = 0; p_pos <= route.size(); p_pos++) {
-                    for (int d_pos = p_pos; d_pos <= route.size(); d_pos++) {
-                        if (is_feasible_insertion(route, pickup_id, delivery_id, p_pos, d_pos)) {
-                            int old_cost = calculate_route_cost(route);
+    return true;
+}
 
-                            vector<int> test_route = route;
-                            test_route.insert(test_route.begin() + d_pos, delivery_id);
-                            test_route.insert(test_route.begin() + p_pos, pickup_id);
+bool is_feasible_route(const vector<int> &route) {
+    return with_constraint_policy([&](auto policy) { return feasible_route_kernel<decltype(policy)>(route); });
+}
 
-                            int new_cost = calculate_route_cost(test_route);
-                            int cost_increase = new_cost - old_cost;
+// Feasibility, cost and schedule of a whole depot-to-depot route
+struct RouteEvaluation {
+    bool feasible = true;
+    int cost = 0;
+    RouteSegment schedule; // the route as one segment, including both depot visits
+};
 
-                            min_cost_increase = min(min_cost_increase, cost_increase);
-                        }
-                    }
-                }
-            }
+RouteEvaluation evaluate_route(const vector<int> &route) {
+    RouteEvaluation evaluation;
+    evaluation.schedule = depot_start_segment();
+    for (int node_id : route) {
+        evaluation.schedule = concat_segments(evaluation.schedule, node_segment(node_id));
+    }
+    evaluation.schedule = concat_segments(evaluation.schedule, node_segment(0));
+    evaluation.cost = evaluation.schedule.travel;
+    evaluation.feasible = is_feasible_route(route);
+    return evaluation;
+}
 
-            if (min_cost_increase < best_cost_increase) {
-                best_cost_increase = min_cost_increase;
-                best_pickup = pickup_id;
-            }
+// Route evaluations shared by all threads. Ants with a strong greedy bias
+// rebuild the same routes over and over, and first-improvement 2-opt
+// re-checks the same reversals after every accepted move. Entries are keyed
+// by a polynomial hash of the instance id and the node sequence, and keep
+// the sequence for an exact comparison. Each lock-striped shard holds a
+// fixed number of slots recycled by the clock algorithm; slot i keeps its
+// sequence in a flat arena at i * stride, so a miss never allocates.
+class RouteCache {
+public:
+    static const int SHARDS = 16;
+    static const size_t MAX_STRIDE = 256;
+
+    // Total number of entries, 0 turns the cache off
+    void configure(size_t capacity) {
+        per_shard = (capacity + SHARDS - 1) / SHARDS;
+        size_t buckets = 1;
+        while (buckets < 2 * per_shard)
+            buckets <<= 1;
+        for (Shard &shard : shards) {
+            lock_guard<mutex> lock(shard.mtx);
+            shard.slots.clear();
+            shard.slots.reserve(per_shard);
+            shard.index.assign(per_shard > 0 ? buckets : 0, -1);
+            shard.hand = 0;
+            shard.stride = 0;
+            shard.arena.clear();
         }
-
-        return best_pickup;
     }
 
-    int select_aco_pickup(const set<int> &candidates) {
-        if (candidates.empty())
-            return -1;
-
-        vector<int> candidate_list(candidates.begin(), candidates.end());
-        vector<double> probabilities;
-        double total_prob = 0.0;
+    bool enabled() const { return per_shard > 0; }
+
+    // Called once per solve with the longest route worth caching. The arena
+    // only grows, dropping the shard's entries when it does; longer routes
+    // are evaluated directly.
+    void fit(size_t route_nodes) {
+        size_t stride = min(MAX_STRIDE, (route_nodes + 31) & ~(size_t)31);
+        if (per_shard == 0)
+            return;
+        for (Shard &shard : shards) {
+            lock_guard<mutex> lock(shard.mtx);
+            if (shard.stride >= stride)
+                continue;
+            shard.slots.clear();
+            fill(shard.index.begin(), shard.index.end(), -1);
+            shard.hand = 0;
+            shard.stride = stride;
+            shard.arena.assign(per_shard * stride, 0);
+        }
+    }
 
-        for (int pickup_id : candidate_list) {
-            double pheromone_val = 0.0;
-            double heuristic_val = 0.0;
+    RouteEvaluation get(const vector<int> &route) {
+        if (per_shard == 0 || route.empty())
+            return evaluate_route(route);
 
-            // Simple pheromone and heuristic calculation
-            for (int j = 0; j < instance.size; j++) {
-                if (instance.travel_times[pickup_id][j] > 0) {
-                    pheromone_val += pheromone[pickup_id][j];
-                    heuristic_val += 1.0 / (instance.travel_times[pickup_id][j] + 1.0);
+        uint64_t hash = 1469598103934665603ULL ^ instance.id;
+        for (int node_id : route) {
+            hash = (hash + node_id + 1) * 1099511628211ULL;
+        }
+        Shard &shard = shards[hash >> 60];
+        {
+            lock_guard<mutex> lock(shard.mtx);
+            int found = route.size() <= shard.stride ? shard.find(hash) : -1;
+            if (found != -1) {
+                Slot &slot = shard.slots[found];
+                if (slot.instance_id == instance.id && shard.holds(found, route)) {
+                    slot.referenced = true;
+                    shard.hits++;
+                    return slot.evaluation;
                 }
             }
-
-            double prob = pow(pheromone_val + 0.1, hybrid_params.alpha) *
-                          pow(heuristic_val + 0.1, hybrid_params.beta);
-            probabilities.push_back(prob);
-            total_prob += prob;
+            shard.misses++;
         }
 
-        if (total_prob == 0.0)
-            return candidate_list[0];
-
-        double r = dis(gen) * total_prob;
-        double cumulative = 0.0;
-        for (int i = 0; i < candidate_list.size(); i++) {
-            cumulative += probabilities[i];
-            if (r <= cumulative) {
-                return candidate_list[i];
+        RouteEvaluation evaluation = evaluate_route(route);
+
+        lock_guard<mutex> lock(shard.mtx);
+        // Another solve may have grown the arena and dropped the entries meanwhile
+        if (route.size() > shard.stride)
+            return evaluation;
+        int found = shard.find(hash);
+        if (found != -1) {
+            // Hash collision or another thread got here first: overwrite
+            Slot &slot = shard.slots[found];
+            slot.instance_id = instance.id;
+            shard.store(found, route);
+            slot.evaluation = evaluation;
+            return evaluation;
+        }
+        int victim;
+        if (shard.slots.size() < per_shard) {
+            victim = shard.slots.size();
+            shard.slots.emplace_back();
+        } else {
+            while (shard.slots[shard.hand].referenced) {
+                shard.slots[shard.hand].referenced = false;
+                shard.hand = (shard.hand + 1) % shard.slots.size();
             }
+            victim = shard.hand;
+            shard.hand = (shard.hand + 1) % shard.slots.size();
+            shard.erase(shard.slots[victim].hash);
         }
+        Slot &slot = shard.slots[victim];
+        slot.hash = hash;
+        slot.instance_id = instance.id;
+        shard.store(victim, route);
+        slot.evaluation = evaluation;
+        slot.referenced = false;
+        shard.insert(hash, victim);
+        return evaluation;
+    }
 
-        return candidate_list.back();
+    // Hits, misses and entries over all shards
+    void counters(long long &hits, long long &misses, size_t &entries) {
+        hits = misses = 0;
+        entries = 0;
+        for (Shard &shard : shards) {
+            lock_guard<mutex> lock(shard.mtx);
+            hits += shard.hits;
+            misses += shard.misses;
+            entries += shard.slots.size();
+        }
     }
 
-    pair<int, pair<int, int>> find_best_insertion(const HybridSolution &solution, int pickup_id, int delivery_id) {
-        int best_route = -1;
-        pair<int, int> best_positions = {-1, -1};
-        int best_cost_increase = INT_MAX;
+    void reset_counters() {
+        for (Shard &shard : shards) {
+            lock_guard<mutex> lock(shard.mtx);
+            shard.hits = shard.misses = 0;
+        }
+    }
 
-        for (int r = 0; r < solution.routes.size(); r++) {
-            const vector<int> &route = solution.routes[r];
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        uint64_t instance_id = 0;
+        int length = 0;
+        RouteEvaluation evaluation;
+        bool referenced = false;
+    };
+
+    // Slots are found through an open-addressing table of slot numbers
+    // (linear probing, -1 = empty, at most half full), so a steady-state miss
+    // recycles a slot without allocating
+    struct Shard {
+        mutex mtx;
+        vector<Slot> slots;
+        vector<int> index;
+        vector<int> arena; // per_shard * stride nodes
+        size_t stride = 0;
+        size_t hand = 0;
+        long long hits = 0;
+        long long misses = 0;
+
+        bool holds(int slot, const vector<int> &route) const {
+            return slots[slot].length == route.size() &&
+                   equal(route.begin(), route.end(), arena.begin() + slot * stride);
+        }
 
-            for (int p_pos = 0; p_pos <= route.size(); p_pos++) {
-                for (int d_pos = p_pos; d_pos <= route.size(); d_pos++) {
-                    if (is_feasible_insertion(route, pickup_id, delivery_id, p_pos, d_pos)) {
-                        int old_cost = calculate_route_cost(route);
+        void store(int slot, const vector<int> &route) {
+            copy(route.begin(), route.end(), arena.begin() + slot * stride);
+            slots[slot].length = route.size();
+        }
 
-                        vector<int> test_route = route;
-                        test_route.insert(test_route.begin() + d_pos, delivery_id);
-                        test_route.insert(test_route.begin() + p_pos, pickup_id);
+        int find(uint64_t hash) const {
+            size_t mask = index.size() - 1;
+            for (size_t b = hash & mask; index[b] != -1; b = (b + 1) & mask) {
+                if (slots[index[b]].hash == hash)
+                    return index[b];
+            }
+            return -1;
+        }
 
-                        int new_cost = calculate_route_cost(test_route);
-                        int cost_increase = new_cost - old_cost;
+        void insert(uint64_t hash, int slot) {
+            size_t mask = index.size() - 1;
+            size_t b = hash & mask;
+            while (index[b] != -1)
+                b = (b + 1) & mask;
+            index[b] = slot;
+        }
 
-                        if (cost_increase < best_cost_increase) {
-                            best_cost_increase = cost_increase;
-                            best_route = r;
-                            best_positions = {p_pos, d_pos};
-                        }
-                    }
+        // Backward-shift deletion keeps every probe chain unbroken
+        void erase(uint64_t hash) {
+            size_t mask = index.size() - 1;
+            size_t b = hash & mask;
+            while (index[b] != -1 && slots[index[b]].hash != hash)
+                b = (b + 1) & mask;
+            if (index[b] == -1)
+                return;
+            for (size_t next = (b + 1) & mask; index[next] != -1; next = (next + 1) & mask) {
+                size_t home = slots[index[next]].hash & mask;
+                // Move next into the hole unless its home lies cyclically in (b, next]
+                if (((next - home) & mask) >= ((next - b) & mask)) {
+                    index[b] = index[next];
+                    b = next;
                 }
             }
+            index[b] = -1;
         }
+    };
 
-        return {best_route, best_positions};
-    }
+    size_t per_shard = 0;
+    Shard shards[SHARDS];
 };
 
-void update_pheromone(const vector<HybridSolution> &solutions) {
-    // Evaporation
-    for (int i = 0; i < instance.size; i++) {
-        for (int j = 0; j < instance.size; j++) {
-            pheromone[i][j] = (1.0 - hybrid_params.rho) * pheromone[i][j];
+RouteCache route_cache;
+
+// Per-route forward/backward summaries, rebuilt after each committed
+// insertion. forward[k] covers depot..v[k-1] and backward[k] covers
+// v[k]..depot; inner ranges are concatenated from the nodes on demand.
+struct RouteState {
+    int length = 0;
+    int cost = 0;
+    vector<int> nodes;
+    vector<RouteSegment> forward;
+    vector<RouteSegment> backward;
+
+    void build(const vector<int> &route) {
+        length = route.size();
+        reserve(length);
+        nodes.assign(route.begin(), route.end());
+        forward.resize(length + 1);
+        backward.resize(length + 1);
+
+        forward[0] = depot_start_segment();
+        for (int k = 0; k < length; k++) {
+            forward[k + 1] = concat_segments(forward[k], node_segment(route[k]));
         }
-    }
 
-    // Reinforce best solutions
-    for (int sol_idx = 0; sol_idx < min(hybrid_params.elite_solutions, (int)solutions.size()); sol_idx++) {
-        const HybridSolution &solution = solutions[sol_idx];
-        double delta_tau = 10.0 / (solution.total_cost + 1.0);
+        backward[length] = node_segment(0);
+        for (int k = length - 1; k >= 0; k--) {
+            backward[k] = concat_segments(node_segment(route[k]), backward[k + 1]);
+        }
 
-        for (const auto &route : solution.routes) {
-            if (!route.empty()) {
-                pheromone[0][route[0]] += delta_tau;
-                for (int i = 0; i < route.size() - 1; i++) {
-                    pheromone[route[i]][route[i + 1]] += delta_tau;
-                }
-                pheromone[route.back()][0] += delta_tau;
-            }
+        cost = calculate_route_cost(route);
+    }
+
+    // The summaries of a state are reused for whatever route it holds next,
+    // so they get room for every pair at once
+    void reserve(int n) {
+        size_t all_pairs = 2 * pickup_nodes.size() + 1;
+        if (forward.capacity() < n + 1) {
+            nodes.reserve(max<size_t>(n, all_pairs));
+            forward.reserve(max<size_t>(n + 1, all_pairs));
+            backward.reserve(max<size_t>(n + 1, all_pairs));
         }
     }
-}
 
-HybridSolution hybrid_aco_solve(int num_routes) {
-    initialize_pheromone();
+    // v[i..j], O(j - i); hot loops extend their segment a node at a time instead
+    RouteSegment segment(int i, int j) const {
+        RouteSegment seg = node_segment(nodes[i]);
+        for (int k = i + 1; k <= j; k++)
+            seg = concat_segments(seg, node_segment(nodes[k]));
+        return seg;
+    }
 
-    HybridSolution best_solution(num_routes);
-    best_solution.total_cost = INT_MAX;
+    // Check of inserting pickup at p_pos and delivery at d_pos (positions in
+    // the current route, same convention as vector::insert of delivery first)
+    bool evaluate_insertion(int pickup_id, int delivery_id, int pickup_pos, int delivery_pos,
+                            int &cost_increase) const {
+        if (pickup_pos > delivery_pos)
+            return false;
 
-    // Start with pure greedy solution
-    vector<vector<int>> initial_routes = pure_greedy_insertion(num_routes);
-    HybridSolution initial_solution(num_routes);
-    initial_solution.routes = initial_routes;
-    initial_solution.calculate_cost();
-    best_solution = initial_solution;
+        RouteSegment seg = concat_segments(forward[pickup_pos], node_segment(pickup_id));
+        if (pickup_pos < delivery_pos)
+            seg = concat_segments(seg, segment(pickup_pos, delivery_pos - 1));
+        seg = concat_segments(seg, node_segment(delivery_id));
+        seg = concat_segments(seg, backward[delivery_pos]);
 
-    cout << "Starting Simplified Hybrid ACO-Greedy..." << endl;
-    cout << "Initial greedy solution cost: " << best_solution.total_cost << endl;
+        PROFILE_COUNT(COUNT_INSERTION_CHECKS, 1);
+        if (!is_feasible_segment(seg))
+            return false;
+        PROFILE_COUNT(COUNT_FEASIBLE_INSERTIONS, 1);
 
-    int no_improvement_count = 0;
+        cost_increase = seg.travel - cost;
+        return true;
+    }
+};
 
-    for (int iter = 0; iter < hybrid_params.max_iterations; iter++) {
-        vector<HybridSolution> iteration_solutions;
+struct InsertionMove {
+    int route_idx = -1;
+    int pickup_pos = -1;
+    int delivery_pos = -1;
+    int cost_increase = INT_MAX;
+};
 
-        // Generate solutions with hybrid ants
-        for (int ant = 0; ant < hybrid_params.num_ants; ant++) {
-            HybridAnt hybrid_ant;
-            HybridSolution solution = hybrid_ant.construct_solution(num_routes);
+// Plan locks for incremental re-optimization. A served node keeps its place
+// and nothing may be inserted before it; a delivery whose pickup was served
+// stays on its route. Empty when nothing is locked.
+enum NodeLock { LOCK_NONE, LOCK_PINNED, LOCK_SERVED };
+thread_local vector<char> node_locks;
 
-            // Apply local search occasionally
-            if (dis_global(gen_global) < hybrid_params.local_search_prob) {
-                solution = local_search_2opt(solution);
-            }
+bool is_locked(int node_id) { return !node_locks.empty() && node_locks[node_id] != LOCK_NONE; }
 
-            iteration_solutions.push_back(solution);
-        }
+// First position of a route open to insertions: after its served prefix
+int first_free_position(const vector<int> &route) {
+    int k = 0;
+    if (!node_locks.empty()) {
+        while (k < route.size() && node_locks[route[k]] == LOCK_SERVED)
+            k++;
+    }
+    return k;
+}
 
-        // Sort by quality
-        sort(iteration_solutions.begin(), iteration_solutions.end());
+// Cheapest feasible insertion of one pair into one route. Only replaces best on
+// a strictly lower cost, so scanning routes in order keeps the first minimum.
+// With granular set, only positions where the pickup or the delivery ends up
+// next to one of its candidate neighbours are tried (an empty route is always
+// tried, it has a single position). Positions before first_pos are skipped.
+template <class Policy>
+bool best_insertion_kernel(const RouteState &state, int route_idx, int pickup_id, int delivery_id,
+                           InsertionMove &best, bool granular, int first_pos) {
+    bool found = false;
+    RouteSegment pickup_seg = node_segment(pickup_id);
+    RouteSegment delivery_seg = node_segment(delivery_id);
+    granular = granular && state.length > 0;
+
+    for (int p_pos = first_pos; p_pos <= state.length; p_pos++) {
+        if (!arcs.compatible(state.forward[p_pos].last, pickup_id))
+            continue;
+        bool pickup_near = !granular || candidates.contains(state.forward[p_pos].last, pickup_id) ||
+                           candidates.contains(pickup_id, state.backward[p_pos].first);
 
-        // Update best solution
-        if (!iteration_solutions.empty() && iteration_solutions[0] < best_solution) {
-            best_solution = iteration_solutions[0];
-            no_improvement_count = 0;
-            cout << "Iteration " << iter + 1 << ": New best cost = "
-                 << best_solution.total_cost << ", Routes used = "
-                 << best_solution.used_routes << endl;
-        } else {
-            no_improvement_count++;
-        }
+        RouteSegment head = concat_segments(state.forward[p_pos], pickup_seg);
+        if (!head.feasible || (Policy::capacity && head.max_load > instance.capacity))
+            continue;
+
+        // Without the arc to the next node the delivery must follow at once
+        int last_d = arcs.compatible(pickup_id, state.backward[p_pos].first) ? state.length : p_pos;
+        RouteSegment mid = head;
+        for (int d_pos = p_pos; d_pos <= last_d; d_pos++) {
+            if (d_pos > p_pos) {
+                // mid grows by the node the delivery now follows; extending it
+                // can only make it later and fuller
+                mid = concat_segments(mid, node_segment(state.nodes[d_pos - 1]));
+                if (!mid.feasible || (Policy::capacity && mid.max_load > instance.capacity))
+                    break;
+            }
+            int before = d_pos == p_pos ? pickup_id : state.nodes[d_pos - 1];
+            if (!arcs.compatible(before, delivery_id) || !arcs.compatible(delivery_id, state.backward[d_pos].first))
+                continue;
+
+            if (!pickup_near && !candidates.contains(before, delivery_id) &&
+                !candidates.contains(delivery_id, state.backward[d_pos].first))
+                continue;
+
+            RouteSegment full = concat_segments(concat_segments(mid, delivery_seg), state.backward[d_pos]);
+            PROFILE_COUNT(COUNT_INSERTION_CHECKS, 1);
+            if (!is_feasible_segment<Policy>(full))
+                continue;
+            PROFILE_COUNT(COUNT_FEASIBLE_INSERTIONS, 1);
+
+            int cost_increase = full.travel - state.cost;
+            if (cost_increase < best.cost_increase) {
+                best.route_idx = route_idx;
+                best.pickup_pos = p_pos;
+                best.delivery_pos = d_pos;
+                best.cost_increase = cost_increase;
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+bool best_insertion_in_route(const RouteState &state, int route_idx, int pickup_id, int delivery_id,
+                             InsertionMove &best, bool granular = false, int first_pos = 0) {
+    return with_constraint_policy([&](auto policy) {
+        return best_insertion_kernel<decltype(policy)>(state, route_idx, pickup_id, delivery_id, best, granular,
+                                                       first_pos);
+    });
+}
+
+void apply_insertion(vector<int> &route, int pickup_id, int delivery_id, int pickup_pos, int delivery_pos) {
+    // Room for every pair up front, so a pooled route never reallocates
+    if (route.capacity() < route.size() + 2)
+        route.reserve(max(route.size() + 2, 2 * pickup_nodes.size()));
+    route.insert(route.begin() + delivery_pos, delivery_id);
+    route.insert(route.begin() + pickup_pos, pickup_id);
+}
+
+// Pickup ids in ascending order in one array: iterates like set<int>, but
+// once grown, inserting and erasing never allocate
+class PickupSet {
+public:
+    vector<int>::const_iterator begin() const { return ids.begin(); }
+    vector<int>::const_iterator end() const { return ids.end(); }
+    bool empty() const { return ids.empty(); }
+    size_t size() const { return ids.size(); }
+    void clear() { ids.clear(); }
+    void reserve(size_t n) { ids.reserve(n); }
+
+    void insert(int id) {
+        auto it = lower_bound(ids.begin(), ids.end(), id);
+        if (it == ids.end() || *it != id)
+            ids.insert(it, id);
+    }
+
+    void erase(int id) {
+        auto it = lower_bound(ids.begin(), ids.end(), id);
+        if (it != ids.end() && *it == id)
+            ids.erase(it);
+    }
+
+private:
+    vector<int> ids;
+};
+
+// Construction state shared by pure greedy and the ants. For every unrouted
+// pair it caches the cheapest insertion into each route, so committing an
+// insertion only re-evaluates the one route that changed. Pairs are ranked by
+// cheapest cost (regret_k == 1, ties to the lower pickup id as in a plain
+// scan) or by regret-k: the summed cost gap between the best route and the
+// next k-1 routes, so pairs with few good options go first. All state lives
+// in flat arrays, so an engine reset for the next ant reuses its storage.
+class InsertionEngine {
+public:
+    vector<vector<int>> routes;
+    PickupSet unrouted;
+
+    // Starts from num_routes empty routes, keeping their storage. Each gets
+    // room for every pair, so a route first used late does not allocate.
+    void reset(int num_routes, int regret_k) {
+        routes.resize(num_routes);
+        for (auto &route : routes) {
+            route.clear();
+            route.reserve(2 * pickup_nodes.size());
+        }
+        start(regret_k);
+    }
+
+    // Starts from partial routes; only pairs not already in them are unrouted
+    void reset(const vector<vector<int>> &initial_routes, int regret_k) {
+        routes = initial_routes;
+        start(regret_k);
+    }
+
+    void start(int regret_k) {
+        this->regret_k = max(1, regret_k);
+        int num_routes = routes.size();
+        states.resize(num_routes);
+        routed.assign(instance.size, 0);
+        for (int r = 0; r < num_routes; r++) {
+            states[r].build(routes[r]);
+            for (int node_id : routes[r]) {
+                routed[node_id] = 1;
+            }
+        }
+
+        int num_pairs = pickup_nodes.size();
+        route_best.assign((size_t)num_pairs * num_routes, InsertionMove());
+        best.assign(num_pairs, InsertionMove());
+        full_search.assign(num_pairs, !candidates.enabled());
+        keys.assign(num_pairs, RankKey());
+        queued.assign(num_pairs, 0);
+        unrouted.clear();
+        unrouted.reserve(num_pairs);
+
+        for (int i = 0; i < num_pairs; i++) {
+            int pickup_id = pickup_nodes[i].id;
+            if (routed[pickup_id])
+                continue;
+            unrouted.insert(pickup_id);
+            for (int r = 0; r < num_routes; r++) {
+                evaluate(i, r);
+            }
+            rank(i);
+        }
+    }
+
+    // Best-ranked pair with a feasible insertion, or -1
+    int select() const {
+        int selected = -1;
+        for (int i = 0; i < keys.size(); i++) {
+            if (queued[i] && (selected == -1 || keys[i] < keys[selected]))
+                selected = i;
+        }
+        return selected == -1 ? -1 : get<2>(keys[selected]);
+    }
+
+    // Cheapest insertion of the pair over all routes (route_idx == -1 if none)
+    const InsertionMove &best_move(int pickup_id) const { return best[pickup_index[pickup_id]]; }
+
+    void commit(int pickup_id, const InsertionMove &move) {
+        int i = pickup_index[pickup_id];
+        int r = move.route_idx;
+        apply_insertion(routes[r], pickup_id, instance.nodes[pickup_id].delivery_pair, move.pickup_pos,
+                        move.delivery_pos);
+        states[r].build(routes[r]);
+
+        queued[i] = 0;
+        unrouted.erase(pickup_id);
+
+        for (int pickup : unrouted) {
+            int j = pickup_index[pickup];
+            evaluate(j, r);
+            rank(j);
+        }
+    }
+
+    // Continues after pairs were taken out of the routes and added to
+    // unrouted: rebuilds the states of the changed routes, keeps all others and
+    // evaluates only the unrouted pairs
+    void reopen(const vector<int> &changed_routes, int regret_k) {
+        this->regret_k = max(1, regret_k);
+        for (int r : changed_routes) {
+            states[r].build(routes[r]);
+        }
+        fill(queued.begin(), queued.end(), 0);
+        for (int pickup_id : unrouted) {
+            int i = pickup_index[pickup_id];
+            full_search[i] = !candidates.enabled();
+            for (int r = 0; r < routes.size(); r++) {
+                evaluate(i, r);
+            }
+            rank(i);
+        }
+    }
+
+    // Puts a route back, e.g. when a move is rolled back
+    void set_route(int r, const vector<int> &route) {
+        routes[r] = route;
+        states[r].build(route);
+    }
+
+    int route_cost(int r) const { return states[r].cost; }
+
+private:
+    // (primary, secondary, pickup id), smallest first
+    typedef tuple<long long, int, int> RankKey;
+
+    int regret_k = 1;
+    vector<RouteState> states;
+    vector<InsertionMove> route_best;
+    vector<InsertionMove> best;
+    vector<char> full_search;
+    vector<RankKey> keys;
+    vector<char> queued; // pair has a feasible insertion and takes part in select()
+    vector<char> routed;
+
+    void evaluate(int i, int r) {
+        int pickup_id = pickup_nodes[i].id;
+        InsertionMove &move = route_best[(size_t)i * routes.size() + r];
+        move = InsertionMove();
+        best_insertion_in_route(states[r], r, pickup_id, instance.nodes[pickup_id].delivery_pair, move,
+                                !full_search[i], first_free_position(routes[r]));
+    }
+
+    void rank(int i) {
+        const InsertionMove *row = &route_best[(size_t)i * routes.size()];
+        InsertionMove cheapest;
+        for (int r = 0; r < routes.size(); r++) {
+            if (row[r].cost_increase < cheapest.cost_increase)
+                cheapest = row[r];
+        }
+
+        // A pair with no granular position anywhere falls back to all positions
+        if (cheapest.route_idx == -1 && !full_search[i]) {
+            full_search[i] = true;
+            for (int r = 0; r < routes.size(); r++) {
+                evaluate(i, r);
+                if (row[r].cost_increase < cheapest.cost_increase)
+                    cheapest = row[r];
+            }
+        }
+        best[i] = cheapest;
+
+        RankKey key(0, 0, pickup_nodes[i].id);
+        if (cheapest.route_idx != -1) {
+            if (regret_k == 1) {
+                get<0>(key) = cheapest.cost_increase;
+            } else {
+                // Routes without a feasible insertion count as a large gap
+                const long long missing = 1000000;
+                long long costs[16];
+                int k = min(regret_k, 16), found = 0;
+                for (int r = 0; r < routes.size(); r++) {
+                    if (row[r].route_idx == -1)
+                        continue;
+                    long long c = row[r].cost_increase;
+                    int pos = min(found, k - 1);
+                    if (found >= k && c >= costs[k - 1])
+                        continue;
+                    while (pos > 0 && costs[pos - 1] > c) {
+                        costs[pos] = costs[pos - 1];
+                        pos--;
+                    }
+                    costs[pos] = c;
+                    found = min(found + 1, k);
+                }
+                long long regret = 0;
+                for (int h = 1; h < k; h++) {
+                    regret += h < found ? costs[h] - costs[0] : missing;
+                }
+                get<0>(key) = -regret;
+                get<1>(key) = cheapest.cost_increase;
+            }
+        }
+
+        keys[i] = key;
+        queued[i] = cheapest.route_idx != -1;
+    }
+};
+
+// Greedily inserts every pair missing from the given routes, as far as
+// capacity and time windows allow
+vector<vector<int>> greedy_complete(const vector<vector<int>> &routes) {
+    PROFILE_SCOPE(PHASE_GREEDY);
+    InsertionEngine engine;
+    engine.reset(routes, hybrid_params.regret_k);
+
+    int pickup_id;
+    while ((pickup_id = engine.select()) != -1) {
+        engine.commit(pickup_id, engine.best_move(pickup_id));
+    }
+
+    return engine.routes;
+}
+
+// Pure greedy insertion - exactly like PDPTW_GREEDY_INSERTION.cpp when
+// regret_k is 1, regret-k insertion otherwise
+vector<vector<int>> pure_greedy_insertion(int num_routes) {
+    return greedy_complete(vector<vector<int>>(num_routes));
+}
+
+// ACO attractiveness of a pickup: pow(tau + 0.1, alpha) * pow(eta + 0.1, beta),
+// with tau and eta summed over the pickup's neighbourhood (its candidate list,
+// or every node with a positive travel time). eta = 1 / (t + 1) depends only on
+// the instance; tau only changes when the pheromone matrix does, so both are
+// aggregated here instead of on every ant step.
+thread_local vector<double> pickup_heuristic;
+
+void compute_pickup_heuristic() {
+    pickup_heuristic.assign(pickup_nodes.size(), 0.0);
+    for (int i = 0; i < pickup_nodes.size(); i++) {
+        int pickup_id = pickup_nodes[i].id;
+        const int *times = instance.travel_times[pickup_id];
+        if (candidates.enabled()) {
+            for (int j : candidates.lists[pickup_id]) {
+                if (times[j] > 0)
+                    pickup_heuristic[i] += 1.0 / (times[j] + 1.0);
+            }
+        } else {
+            for (int j = 0; j < instance.size; j++) {
+                if (times[j] > 0)
+                    pickup_heuristic[i] += 1.0 / (times[j] + 1.0);
+            }
+        }
+    }
+}
+
+void refresh_attractiveness(Colony &colony) {
+    const PheromoneTrails &pheromone = colony.pheromone;
+    colony.pickup_attractiveness.assign(pickup_nodes.size(), 0.0);
+    for (int i = 0; i < pickup_nodes.size(); i++) {
+        int pickup_id = pickup_nodes[i].id;
+        double pheromone_val = candidates.enabled()
+                                   ? pheromone.edge_sum(pickup_id, candidates.lists[pickup_id], instance.travel_times)
+                                   : pheromone.row_sum(pickup_id, instance.travel_times);
+        colony.pickup_attractiveness[i] =
+            pow(pheromone_val + 0.1, colony.params.alpha) * pow(pickup_heuristic[i] + 0.1, colony.params.beta);
+    }
+}
+
+// Fenwick tree over pickup weights: O(P) build, O(log P) removal and
+// weighted sampling
+class FenwickSampler {
+public:
+    void build(const vector<double> &values) {
+        weights = values;
+        n = weights.size();
+        tree.assign(n + 1, 0.0);
+        for (int i = 1; i <= n; i++) {
+            tree[i] += weights[i - 1];
+            int parent = i + (i & -i);
+            if (parent <= n)
+                tree[parent] += tree[i];
+        }
+        total_weight = accumulate(weights.begin(), weights.end(), 0.0);
+    }
+
+    void remove(int index) {
+        double w = weights[index];
+        if (w == 0.0)
+            return;
+        weights[index] = 0.0;
+        total_weight -= w;
+        for (int i = index + 1; i <= n; i += i & -i) {
+            tree[i] -= w;
+        }
+    }
+
+    double total() const { return total_weight; }
+
+    // Index whose cumulative weight interval contains target, -1 if that
+    // lands on a removed entry through rounding
+    int find(double target) const {
+        int pos = 0;
+        int step = 1;
+        while (step * 2 <= n)
+            step *= 2;
+        for (; step > 0; step /= 2) {
+            if (pos + step <= n && tree[pos + step] <= target) {
+                pos += step;
+                target -= tree[pos];
+            }
+        }
+        return pos < n && weights[pos] > 0.0 ? pos : -1;
+    }
+
+private:
+    int n = 0;
+    double total_weight = 0.0;
+    vector<double> weights;
+    vector<double> tree;
+};
+
+// Trails are sparse with candidate lists, as the ants then read no other
+// edges, and from SPARSE_PHEROMONE_NODES nodes on, where the dense matrix
+// and its sweep outgrow the caches. The sparse store keeps the candidate
+// edges, or else the SPARSE_PHEROMONE_K most related nodes of each node.
+const int SPARSE_PHEROMONE_NODES = 1000;
+const int SPARSE_PHEROMONE_K = 32;
+
+bool use_sparse_pheromone() { return candidates.enabled() || instance.size >= SPARSE_PHEROMONE_NODES; }
+
+// Stored edges of the sparse store, kept for the instance they were built for
+thread_local vector<vector<int>> pheromone_rows;
+thread_local uint64_t pheromone_rows_instance = 0;
+
+void init_trails(PheromoneTrails &pheromone, bool sparse, double value) {
+    if (!sparse) {
+        pheromone.init_dense(instance.size, value);
+        return;
+    }
+    if (candidates.enabled()) {
+        pheromone.init_sparse(instance.size, value, candidates.lists, instance.travel_times);
+        return;
+    }
+    if (pheromone_rows_instance != instance.id || pheromone_rows.size() != instance.size) {
+        pheromone_rows = related_node_lists(SPARSE_PHEROMONE_K);
+        pheromone_rows_instance = instance.id;
+    }
+    pheromone.init_sparse(instance.size, value, pheromone_rows, instance.travel_times);
+}
+
+// Uniform trails plus a bonus along the given (greedy) routes
+void initialize_pheromone(Colony &colony, const vector<vector<int>> &greedy_routes) {
+    PheromoneTrails &pheromone = colony.pheromone;
+    init_trails(pheromone, use_sparse_pheromone(), 1.0);
+
+    const double uncapped = numeric_limits<double>::infinity();
+    for (const auto &route : greedy_routes) {
+        if (!route.empty()) {
+            pheromone.deposit(0, route[0], 2.0, uncapped);
+            for (int i = 0; i < route.size() - 1; i++) {
+                pheromone.deposit(route[i], route[i + 1], 2.0, uncapped);
+            }
+            pheromone.deposit(route.back(), 0, 2.0, uncapped);
+        }
+    }
+
+    refresh_attractiveness(colony);
+}
+
+struct HybridSolution {
+    vector<vector<int>> routes;
+    int total_cost;
+    int used_routes;
+    int served_pairs;
+
+    HybridSolution(int num_routes) : routes(num_routes), total_cost(0), used_routes(0), served_pairs(0) {}
+
+    // Empty again with num_routes routes, keeping the route storage
+    void reset(int num_routes) {
+        routes.resize(num_routes);
+        for (auto &route : routes)
+            route.clear();
+        total_cost = used_routes = served_pairs = 0;
+    }
+
+    void calculate_cost() {
+        total_cost = 0;
+        used_routes = 0;
+        served_pairs = 0;
+        for (const auto &route : routes) {
+            if (!route.empty()) {
+                total_cost += route_cache.get(route).cost;
+                used_routes++;
+                served_pairs += route.size() / 2;
+            }
+        }
+    }
+
+    bool serves_all() const { return served_pairs == (int)pickup_nodes.size(); }
+
+    // More pairs served first, then fewer routes, then lower cost
+    bool operator<(const HybridSolution &other) const {
+        if (served_pairs != other.served_pairs) {
+            return served_pairs > other.served_pairs;
+        }
+        if (used_routes != other.used_routes) {
+            return used_routes < other.used_routes;
+        }
+        return total_cost < other.total_cost;
+    }
+};
+
+// Simple 2-opt local search
+void improve_2opt(HybridSolution &improved) {
+    PROFILE_SCOPE(PHASE_LOCAL_SEARCH_2OPT);
+    thread_local vector<int> new_route;
+
+    for (int r = 0; r < improved.routes.size(); r++) {
+        vector<int> &route = improved.routes[r];
+        if (route.size() < 4)
+            continue;
+
+        bool improved_route = true;
+        while (improved_route && !solve_should_stop()) {
+            improved_route = false;
+            int current_cost = route_cache.get(route).cost;
+
+            // The reversed stretch route[i + 1..j] must hold no locked node
+            for (int i = max(0, first_free_position(route) - 1); i < route.size() - 3; i++) {
+                if (is_locked(route[i + 1]))
+                    continue;
+                for (int j = i + 2; j < route.size() - 1 && !is_locked(route[j]); j++) {
+                    // Reversed arcs inside the stretch; a bad one rules out every longer stretch
+                    if (!arcs.compatible(route[j], route[j - 1]))
+                        break;
+                    if (!arcs.compatible(route[i], route[j]) || !arcs.compatible(route[i + 1], route[j + 1]))
+                        continue;
+                    // New edge (route[i], route[j]) must be a candidate one
+                    if (candidates.enabled() && !candidates.contains(route[i], route[j]))
+                        continue;
+
+                    new_route.assign(route.begin(), route.end());
+                    PROFILE_COUNT(COUNT_ROUTE_COPIES, 1);
+                    reverse(new_route.begin() + i + 1, new_route.begin() + j + 1);
+
+                    // Reversals are nearly always new routes, so they skip the cache
+                    if (is_feasible_route(new_route)) {
+                        int new_cost = calculate_route_cost(new_route);
+                        if (new_cost < current_cost) {
+                            route = new_route;
+                            current_cost = new_cost;
+                            improved_route = true;
+                            PROFILE_COUNT(COUNT_LOCAL_SEARCH_MOVES, 1);
+                            break;
+                        }
+                    }
+                }
+                if (improved_route)
+                    break;
+            }
+        }
+    }
+
+    improved.calculate_cost();
+}
+
+HybridSolution local_search_2opt(const HybridSolution &solution) {
+    HybridSolution improved = solution;
+    PROFILE_COUNT(COUNT_ROUTE_COPIES, improved.routes.size());
+    improve_2opt(improved);
+    return improved;
+}
+
+// A route with up to two positions removed, addressed by positions of the
+// reduced route. Any range of the reduced route is at most three inner
+// segments of the original.
+struct ReducedRoute {
+    const RouteState *state;
+    int skip_a; // removed original positions, skip_a < skip_b, -1 if unused
+    int skip_b;
+    int length;
+
+    ReducedRoute(const RouteState &s, int a = -1, int b = -1) : state(&s), skip_a(a), skip_b(b) {
+        length = s.length - (a >= 0) - (b >= 0);
+    }
+
+    int original(int k) const {
+        if (skip_a >= 0 && k >= skip_a)
+            k++;
+        if (skip_b >= 0 && k >= skip_b)
+            k++;
+        return k;
+    }
+
+    // Node at reduced position k; the depot before the first and after the last
+    int node(int k) const {
+        if (k < 0 || k >= length)
+            return 0;
+        return state->nodes[original(k)];
+    }
+
+    // seg followed by positions a..b of the reduced route
+    RouteSegment append(RouteSegment seg, int a, int b) const {
+        if (a > b)
+            return seg;
+        int start = original(a), end = original(b);
+        // Adjacent skips leave start on the second one, so it is skipped as well
+        for (int skip : {skip_a, skip_b}) {
+            if (skip >= start && skip <= end) {
+                if (skip > start)
+                    seg = concat_segments(seg, state->segment(start, skip - 1));
+                start = skip + 1;
+            }
+        }
+        return concat_segments(seg, state->segment(start, end));
+    }
+
+    RouteSegment whole() const { return concat_segments(append(depot_start_segment(), 0, length - 1), node_segment(0)); }
+};
+
+// Cheapest feasible insertion of a pair into a reduced route at or after
+// first_pos; cost is the travel time of the resulting route
+template <class Policy>
+bool reduced_insertion_kernel(const ReducedRoute &route, int pickup_id, int delivery_id, int &best_cost,
+                              int &best_p, int &best_d, int first_pos) {
+    bool found = false;
+    RouteSegment pickup_seg = node_segment(pickup_id);
+    RouteSegment delivery_seg = node_segment(delivery_id);
+
+    // tail[k] covers reduced positions k.. and the depot
+    thread_local vector<RouteSegment> tail;
+    if (tail.capacity() < route.length + 1)
+        tail.reserve(max<size_t>(route.length + 1, 2 * pickup_nodes.size() + 1));
+    tail.resize(route.length + 1);
+    tail[route.length] = node_segment(0);
+    for (int k = route.length - 1; k >= first_pos; k--)
+        tail[k] = concat_segments(node_segment(route.node(k)), tail[k + 1]);
+
+    RouteSegment prefix = route.append(depot_start_segment(), 0, first_pos - 1);
+    for (int p_pos = first_pos; p_pos <= route.length; p_pos++) {
+        if (p_pos > first_pos)
+            prefix = concat_segments(prefix, node_segment(route.node(p_pos - 1)));
+        if (!arcs.compatible(route.node(p_pos - 1), pickup_id))
+            continue;
+        RouteSegment head = concat_segments(prefix, pickup_seg);
+        if (!head.feasible || (Policy::capacity && head.max_load > instance.capacity))
+            continue;
+
+        // Without the arc to the next node the delivery must follow at once
+        int last_d = arcs.compatible(pickup_id, route.node(p_pos)) ? route.length : p_pos;
+        RouteSegment mid = head;
+        for (int d_pos = p_pos; d_pos <= last_d; d_pos++) {
+            if (d_pos > p_pos) {
+                mid = concat_segments(mid, node_segment(route.node(d_pos - 1)));
+                if (!mid.feasible || (Policy::capacity && mid.max_load > instance.capacity))
+                    break;
+            }
+            int before = d_pos == p_pos ? pickup_id : route.node(d_pos - 1);
+            if (!arcs.compatible(before, delivery_id) || !arcs.compatible(delivery_id, route.node(d_pos)))
+                continue;
+
+            RouteSegment full = concat_segments(concat_segments(mid, delivery_seg), tail[d_pos]);
+            PROFILE_COUNT(COUNT_INSERTION_CHECKS, 1);
+            if (!is_feasible_segment<Policy>(full))
+                continue;
+            PROFILE_COUNT(COUNT_FEASIBLE_INSERTIONS, 1);
+            if (full.travel < best_cost) {
+                best_cost = full.travel;
+                best_p = p_pos;
+                best_d = d_pos;
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+bool best_insertion_in_reduced(const ReducedRoute &route, int pickup_id, int delivery_id, int &best_cost,
+                               int &best_p, int &best_d, int first_pos = 0) {
+    return with_constraint_policy([&](auto policy) {
+        return reduced_insertion_kernel<decltype(policy)>(route, pickup_id, delivery_id, best_cost, best_p, best_d,
+                                                          first_pos);
+    });
+}
+
+enum LocalSearchMoveType { LS_NONE, LS_OR_OPT, LS_RELOCATE, LS_EXCHANGE };
+
+struct LocalSearchMove {
+    LocalSearchMoveType type = LS_NONE;
+    int route_delta = 0;
+    int cost_delta = 0;
+    int r = -1;          // source route
+    int s = -1;          // target route (relocate / exchange)
+    int seg_begin = 0;   // or-opt: v[seg_begin..seg_end] of r moves before original v[target]
+    int seg_end = 0;
+    int target = 0;
+    int pickup = -1;     // relocate / exchange: pickup moving from r into s at (p_pos, d_pos)
+    int p_pos = 0;
+    int d_pos = 0;
+    int pickup2 = -1;    // exchange: pickup moving from s into r at (p_pos2, d_pos2)
+    int p_pos2 = 0;
+    int d_pos2 = 0;
+
+    // Same order as HybridSolution: fewer routes first, then lower cost
+    bool improves_on(const LocalSearchMove &other) const {
+        if (route_delta != other.route_delta)
+            return route_delta < other.route_delta;
+        return cost_delta < other.cost_delta;
+    }
+};
+
+// Pickup-and-delivery local search: Or-opt of 1-3 consecutive nodes, pair
+// relocation within and between routes and pair exchange between routes.
+// Every candidate is evaluated in O(1) by concatenating RouteState segments
+// with a gap segment that grows a node at a time along the scan; only routes
+// changed by an applied move are rebuilt. First improvement applies the
+// first improving move and resumes scanning at that route; best improvement
+// applies the best move of a full scan.
+class PairLocalSearch {
+public:
+    int moves_applied = 0;
+
+    HybridSolution run(const HybridSolution &solution, bool best_improvement) {
+        HybridSolution improved = solution;
+        PROFILE_COUNT(COUNT_ROUTE_COPIES, improved.routes.size());
+        improve(improved, best_improvement);
+        return improved;
+    }
+
+    // In place; a search object kept for the next call reuses its buffers
+    void improve(HybridSolution &solution, bool best_improvement) {
+        PROFILE_SCOPE(PHASE_LOCAL_SEARCH_PAIRS);
+        this->best_improvement = best_improvement;
+        routes.swap(solution.routes);
+        states.resize(routes.size());
+        route_of.assign(instance.size, -1);
+        position.assign(instance.size, -1);
+        lead.reserve(2 * pickup_nodes.size() + 1);
+        for (int r = 0; r < routes.size(); r++) {
+            refresh(r);
+        }
+
+        int start = 0;
+        while (true) {
+            found = LocalSearchMove();
+            for (int step = 0; step < routes.size() && !stop_scan() && !solve_should_stop(); step++) {
+                int r = (start + step) % routes.size();
+                scan_or_opt(r);
+                if (!stop_scan())
+                    scan_relocate(r);
+                if (!stop_scan())
+                    scan_exchange(r);
+            }
+            if (found.type == LS_NONE)
+                break;
+            start = found.r;
+            apply(found);
+            moves_applied++;
+            PROFILE_COUNT(COUNT_LOCAL_SEARCH_MOVES, 1);
+        }
+
+        routes.swap(solution.routes);
+        solution.calculate_cost();
+    }
+
+private:
+    bool best_improvement = false;
+    vector<vector<int>> routes;
+    vector<RouteState> states;
+    vector<int> route_of;
+    vector<int> position;
+    vector<RouteSegment> lead; // scan_or_opt: lead[q] covers v[q..a-1]
+    LocalSearchMove found;
+
+    bool stop_scan() const { return !best_improvement && found.type != LS_NONE; }
+
+    void consider(const LocalSearchMove &move) {
+        if (move.improves_on(LocalSearchMove()) && (found.type == LS_NONE || move.improves_on(found)))
+            found = move;
+    }
+
+    void refresh(int r) {
+        states[r].build(routes[r]);
+        for (int k = 0; k < routes[r].size(); k++) {
+            route_of[routes[r][k]] = r;
+            position[routes[r][k]] = k;
+        }
+    }
+
+    int partner(int node_id) const {
+        const Node &node = instance.nodes[node_id];
+        return node.is_pickup() ? node.delivery_pair : node.pickup_pair;
+    }
+
+    void scan_or_opt(int r) {
+        const RouteState &state = states[r];
+        const vector<int> &route = routes[r];
+        int length = state.length;
+        int first = first_free_position(route);
+
+        for (int a = first; a < length && !stop_scan(); a++) {
+            lead.resize(length);
+            for (int q = a - 1; q >= first; q--)
+                lead[q] = q == a - 1 ? node_segment(route[q]) : concat_segments(node_segment(route[q]), lead[q + 1]);
+            for (int b = a; b < min(length, a + 3) && !stop_scan(); b++) {
+                if (is_locked(route[b]))
+                    break;
+                // Arc closing the gap the segment leaves
+                if (!arcs.compatible(a > 0 ? route[a - 1] : 0, b + 1 < length ? route[b + 1] : 0))
+                    continue;
+                RouteSegment moved = state.segment(a, b);
+                RouteSegment gap; // v[b+1..q-1] once q passes the segment
+                for (int q = first; q <= length; q++) {
+                    if (q > b + 1)
+                        gap = q == b + 2 ? node_segment(route[b + 1])
+                                         : concat_segments(gap, node_segment(route[q - 1]));
+                    if (q >= a && q <= b + 1)
+                        continue;
+                    if (!arcs.compatible(q > 0 ? route[q - 1] : 0, route[a]) ||
+                        !arcs.compatible(route[b], q < length ? route[q] : 0))
+                        continue;
+
+                    // Moving earlier must not pass a pickup of a delivery in the
+                    // segment; moving later must not pass a delivery of a pickup
+                    bool precedence_ok = true;
+                    for (int k = a; k <= b; k++) {
+                        const Node &node = instance.nodes[route[k]];
+                        int other = position[partner(route[k])];
+                        if ((q < a && node.is_delivery() && other >= q && other < a) ||
+                            (q > b && node.is_pickup() && other > b && other < q)) {
+                            precedence_ok = false;
+                            break;
+                        }
+                    }
+                    if (!precedence_ok)
+                        continue;
+
+                    RouteSegment seg;
+                    if (q < a) {
+                        seg = concat_segments(state.forward[q], moved);
+                        seg = concat_segments(seg, lead[q]);
+                        seg = concat_segments(seg, state.backward[b + 1]);
+                    } else {
+                        seg = concat_segments(state.forward[a], gap);
+                        seg = concat_segments(seg, moved);
+                        seg = concat_segments(seg, state.backward[q]);
+                    }
+                    if (!is_feasible_segment(seg))
+                        continue;
+
+                    LocalSearchMove move;
+                    move.type = LS_OR_OPT;
+                    move.r = r;
+                    move.seg_begin = a;
+                    move.seg_end = b;
+                    move.target = q;
+                    move.cost_delta = seg.travel - state.cost;
+                    consider(move);
+                    if (stop_scan())
+                        return;
+                }
+            }
+        }
+    }
+
+    void scan_relocate(int r) {
+        const vector<int> &route = routes[r];
+        for (int i = 0; i < route.size() && !stop_scan(); i++) {
+            int pickup_id = route[i];
+            if (!instance.nodes[pickup_id].is_pickup())
+                continue;
+            int delivery_id = instance.nodes[pickup_id].delivery_pair;
+            int j = position[delivery_id];
+            if (is_locked(pickup_id) || is_locked(delivery_id))
+                continue;
+
+            ReducedRoute reduced(states[r], i, j);
+            int removed_cost = 0;
+            if (reduced.length > 0) {
+                RouteSegment rest = reduced.whole();
+                if (!is_feasible_segment(rest))
+                    continue;
+                removed_cost = rest.travel;
+            }
+
+            LocalSearchMove move;
+            move.type = LS_RELOCATE;
+            move.r = r;
+            move.pickup = pickup_id;
+
+            // Within the route
+            int best_cost = INT_MAX;
+            if (reduced.length > 0 &&
+                best_insertion_in_reduced(reduced, pickup_id, delivery_id, best_cost, move.p_pos, move.d_pos,
+                                          first_free_position(route))) {
+                move.s = r;
+                move.cost_delta = best_cost - states[r].cost;
+                consider(move);
+            }
+
+            // Into another non-empty route
+            for (int s = 0; s < routes.size() && !stop_scan(); s++) {
+                if (s == r || routes[s].empty())
+                    continue;
+                InsertionMove insertion;
+                if (!best_insertion_in_route(states[s], s, pickup_id, delivery_id, insertion, candidates.enabled(),
+                                             first_free_position(routes[s])))
+                    continue;
+                move.s = s;
+                move.p_pos = insertion.pickup_pos;
+                move.d_pos = insertion.delivery_pos;
+                move.route_delta = reduced.length == 0 ? -1 : 0;
+                move.cost_delta = removed_cost - states[r].cost + insertion.cost_increase;
+                consider(move);
+            }
+        }
+    }
+
+    void scan_exchange(int r) {
+        const vector<int> &route = routes[r];
+        for (int i = 0; i < route.size() && !stop_scan(); i++) {
+            int pickup_a = route[i];
+            if (!instance.nodes[pickup_a].is_pickup())
+                continue;
+            int delivery_a = instance.nodes[pickup_a].delivery_pair;
+            if (is_locked(pickup_a) || is_locked(delivery_a))
+                continue;
+            ReducedRoute reduced_r(states[r], i, position[delivery_a]);
+
+            for (int s = r + 1; s < routes.size() && !stop_scan(); s++) {
+                for (int k = 0; k < routes[s].size() && !stop_scan(); k++) {
+                    int pickup_b = routes[s][k];
+                    if (!instance.nodes[pickup_b].is_pickup())
+                        continue;
+                    if (candidates.enabled() && !candidates.contains(pickup_a, pickup_b))
+                        continue;
+                    int delivery_b = instance.nodes[pickup_b].delivery_pair;
+                    if (is_locked(pickup_b) || is_locked(delivery_b))
+                        continue;
+                    ReducedRoute reduced_s(states[s], k, position[delivery_b]);
+
+                    LocalSearchMove move;
+                    int cost_r = INT_MAX, cost_s = INT_MAX;
+                    if (!best_insertion_in_reduced(reduced_r, pickup_b, delivery_b, cost_r, move.p_pos2, move.d_pos2,
+                                                   first_free_position(route)))
+                        continue;
+                    if (!best_insertion_in_reduced(reduced_s, pickup_a, delivery_a, cost_s, move.p_pos, move.d_pos,
+                                                   first_free_position(routes[s])))
+                        continue;
+
+                    move.type = LS_EXCHANGE;
+                    move.r = r;
+                    move.s = s;
+                    move.pickup = pickup_a;
+                    move.pickup2 = pickup_b;
+                    move.cost_delta = cost_r + cost_s - states[r].cost - states[s].cost;
+                    consider(move);
+                }
+            }
+        }
+    }
+
+    void remove_pair(vector<int> &route, int pickup_id) {
+        int delivery_id = instance.nodes[pickup_id].delivery_pair;
+        route.erase(remove_if(route.begin(), route.end(),
+                              [&](int node) { return node == pickup_id || node == delivery_id; }),
+                    route.end());
+    }
+
+    void apply(const LocalSearchMove &move) {
+        vector<int> &route = routes[move.r];
+        if (move.type == LS_OR_OPT) {
+            int a = move.seg_begin, b = move.seg_end, q = move.target;
+            if (q < a) {
+                rotate(route.begin() + q, route.begin() + a, route.begin() + b + 1);
+            } else {
+                rotate(route.begin() + a, route.begin() + b + 1, route.begin() + q);
+            }
+        } else if (move.type == LS_RELOCATE) {
+            remove_pair(route, move.pickup);
+            apply_insertion(routes[move.s], move.pickup, instance.nodes[move.pickup].delivery_pair, move.p_pos,
+                            move.d_pos);
+        } else if (move.type == LS_EXCHANGE) {
+            remove_pair(route, move.pickup);
+            remove_pair(routes[move.s], move.pickup2);
+            apply_insertion(route, move.pickup2, instance.nodes[move.pickup2].delivery_pair, move.p_pos2,
+                            move.d_pos2);
+            apply_insertion(routes[move.s], move.pickup, instance.nodes[move.pickup].delivery_pair, move.p_pos,
+                            move.d_pos);
+        }
+
+        refresh(move.r);
+        if (move.s >= 0 && move.s != move.r)
+            refresh(move.s);
+    }
+};
+
+HybridSolution local_search_pairs(const HybridSolution &solution, bool best_improvement) {
+    thread_local PairLocalSearch search;
+    return search.run(solution, best_improvement);
+}
+
+// Local search applied to ant solutions, chosen by hybrid_params.local_search.
+// Works in place with per-thread search buffers, so it does not allocate
+// once those have grown.
+void local_search_in_place(HybridSolution &solution) {
+    thread_local PairLocalSearch search;
+    switch (hybrid_params.local_search) {
+    case 0:
+        improve_2opt(solution);
+        break;
+    case 2:
+        search.improve(solution, true);
+        break;
+    default:
+        search.improve(solution, false);
+    }
+}
+
+HybridSolution improve_solution(const HybridSolution &solution) {
+    HybridSolution improved = solution;
+    PROFILE_COUNT(COUNT_ROUTE_COPIES, improved.routes.size());
+    local_search_in_place(improved);
+    return improved;
+}
+
+class HybridAnt {
+private:
+    const Colony &colony;
+    mt19937 &gen;
+    uniform_real_distribution<> dis;
+    // Construction buffers of this thread, reused by its next ant
+    static thread_local InsertionEngine engine;
+    static thread_local FenwickSampler sampler;
+
+public:
+    HybridAnt(const Colony &colony, mt19937 &rng) : colony(colony), gen(rng), dis(0.0, 1.0) {}
+
+    // Builds into solution; its routes trade storage with the engine's
+    void construct_solution(int num_routes, HybridSolution &solution) {
+        PROFILE_SCOPE(PHASE_CONSTRUCT);
+        engine.reset(num_routes, hybrid_params.regret_k);
+        sampler.build(colony.pickup_attractiveness);
+
+        for (int step = 1; !engine.unrouted.empty(); step++) {
+            // An unfinished solution serves fewer pairs and never wins
+            if (step % 16 == 0 && solve_should_stop())
+                break;
+
+            int selected_pickup;
+
+            // Very high probability of greedy selection
+            if (dis(gen) < colony.params.greedy_bias) {
+                selected_pickup = engine.select();
+            } else {
+                selected_pickup = select_aco_pickup(engine.unrouted);
+            }
+
+            if (selected_pickup == -1)
+                break;
+
+            const InsertionMove &best_insertion = engine.best_move(selected_pickup);
+
+            if (best_insertion.route_idx != -1) {
+                engine.commit(selected_pickup, best_insertion);
+                sampler.remove(pickup_index[selected_pickup]);
+            } else {
+                break;
+            }
+        }
+
+        solution.routes.swap(engine.routes);
+        solution.calculate_cost();
+    }
+
+private:
+    int select_aco_pickup(const PickupSet &unrouted) {
+        if (unrouted.empty())
+            return -1;
+
+        if (sampler.total() <= 0.0)
+            return *unrouted.begin();
+
+        int index = sampler.find(dis(gen) * sampler.total());
+        return index == -1 ? *unrouted.begin() : pickup_nodes[index].id;
+    }
+};
+
+thread_local InsertionEngine HybridAnt::engine;
+thread_local FenwickSampler HybridAnt::sampler;
+
+// Adds 10 / (cost + 1) along every arc of the solution, capped at tau_max
+void deposit_pheromone(Colony &colony, const HybridSolution &solution) {
+    PheromoneTrails &pheromone = colony.pheromone;
+    double tau_max = colony.params.tau_max;
+    double delta_tau = 10.0 / (solution.total_cost + 1.0);
+
+    for (const auto &route : solution.routes) {
+        if (!route.empty()) {
+            pheromone.deposit(0, route[0], delta_tau, tau_max);
+            for (int i = 0; i < route.size() - 1; i++) {
+                pheromone.deposit(route[i], route[i + 1], delta_tau, tau_max);
+            }
+            pheromone.deposit(route.back(), 0, delta_tau, tau_max);
+        }
+    }
+}
+
+// Evaporation, then deposits by the best ranked ant solutions of the colony
+void update_pheromone(Colony &colony) {
+    PROFILE_SCOPE(PHASE_UPDATE_PHEROMONE);
+    const HybridParams &params = colony.params;
+
+    // Evaporation, clamped to [tau_min, tau_max]
+    colony.pheromone.evaporate(1.0 - params.rho, params.tau_min, params.tau_max);
+
+    // Reinforce best solutions
+    for (int rank = 0; rank < min(params.elite_solutions, (int)colony.ranking.size()); rank++) {
+        deposit_pheromone(colony, colony.solutions[colony.ranking[rank]]);
+    }
+
+    refresh_attractiveness(colony);
+}
+
+string json_escape(const string &str) {
+    string out = "\"";
+    for (char c : str) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out + "\"";
+}
+
+// Called with every new best solution of a colony run (benchmark timing)
+thread_local function<void(const HybridSolution &)> on_new_best;
+
+// Streams the state of the running colony as one NDJSON line; the routes are
+// included whenever the best solution changed
+void emit_progress(int iteration, int num_routes, const HybridSolution &best, bool improved) {
+    if (improved && on_new_best)
+        on_new_best(best);
+    if (!progress_sink)
+        return;
+
+    ostringstream event;
+    event << "{\"event\":\"progress\",\"iteration\":" << iteration << ",\"num_routes\":" << num_routes
+          << ",\"best_cost\":" << best.total_cost << ",\"routes_used\":" << best.used_routes
+          << ",\"served_pairs\":" << best.served_pairs << ",\"elapsed_ms\":" << solve_elapsed_ms()
+          << ",\"improved\":" << (improved ? "true" : "false");
+    if (improved) {
+        event << ",\"routes\":[";
+        bool first_route = true;
+        for (const auto &route : best.routes) {
+            if (route.empty())
+                continue;
+            event << (first_route ? "[" : ",[");
+            for (int i = 0; i < route.size(); i++) {
+                event << (i ? "," : "") << route[i];
+            }
+            event << "]";
+            first_route = false;
+        }
+        event << "]";
+    }
+    event << "}";
+    progress_sink(event.str());
+}
+
+// Adaptive large neighbourhood search (Ropke & Pisinger) over a fixed number
+// of routes, started from a colony or greedy solution. Every iteration takes
+// a few pairs out with one of four destroy operators (random, largest removal
+// saving, Shaw relatedness, a whole route) and reinserts them with the
+// insertion engine, cheapest first or regret-2/3. Only the routes that lost
+// or gained a pair are rebuilt, and a rejected move restores just those.
+// Operators are drawn by roulette over weights that follow their success in
+// the last segment, and simulated annealing accepts worse solutions early on.
+class AlnsSearch {
+public:
+    explicit AlnsSearch(mt19937 &gen) : gen(gen) {}
+
+    HybridSolution run(const HybridSolution &start, int iterations) {
+        PROFILE_SCOPE(PHASE_ALNS);
+        int num_routes = start.routes.size();
+        engine.reset(start.routes, 1);
+        complete(nullptr);
+
+        // Leaving a pair out must cost more than any detour inserting it
+        unserved_penalty = 0;
+        for (int i = 0; i < instance.size; i++) {
+            for (int j = 0; j < instance.size; j++)
+                unserved_penalty = max<long long>(unserved_penalty, instance.travel_times[i][j]);
+        }
+        unserved_penalty = unserved_penalty * 4 + 1;
+
+        route_of.assign(instance.size, -1);
+        for (int r = 0; r < num_routes; r++) {
+            for (int node_id : engine.routes[r])
+                route_of[node_id] = r;
+        }
+        long long current = objective();
+        HybridSolution best = snapshot();
+
+        destroy_weights.assign(DESTROY_COUNT, 1.0);
+        repair_weights.assign(REPAIR_COUNT, 1.0);
+        destroy_scores.assign(DESTROY_COUNT, 0.0);
+        repair_scores.assign(REPAIR_COUNT, 0.0);
+        destroy_uses.assign(DESTROY_COUNT, 0);
+        repair_uses.assign(REPAIR_COUNT, 0);
+
+        // A move 5% worse than the start is first accepted with probability
+        // 1/2; the temperature falls to 0.2% of that by the last iteration
+        double temperature = max(1.0, 0.05 * current / log(2.0));
+        double cooling = pow(0.002, 1.0 / max(1, iterations));
+        auto started = chrono::steady_clock::now();
+        int iter = 0;
+
+        for (; iter < iterations && !solve_should_stop(); iter++) {
+            int destroy = roulette(destroy_weights);
+            int repair = roulette(repair_weights);
+            vector<int> removed = choose_removal(destroy);
+            if (removed.empty())
+                break;
+
+            backups.clear();
+            touched.assign(num_routes, 0);
+            PickupSet previous_unrouted = engine.unrouted;
+            vector<int> changed;
+            for (int pickup_id : removed) {
+                int r = route_of[pickup_id];
+                int delivery_id = instance.nodes[pickup_id].delivery_pair;
+                if (!touched[r])
+                    changed.push_back(r);
+                touch(r);
+                vector<int> &route = engine.routes[r];
+                route.erase(find(route.begin(), route.end(), pickup_id));
+                route.erase(find(route.begin(), route.end(), delivery_id));
+                engine.unrouted.insert(pickup_id);
+            }
+            engine.reopen(changed, repair + 1);
+            complete(&touched);
+
+            long long candidate = objective();
+            double score = 0;
+            bool accept = candidate < current ||
+                          uniform_real_distribution<>(0.0, 1.0)(gen) < exp((current - candidate) / temperature);
+            if (accept) {
+                HybridSolution solution = snapshot();
+                if (solution < best) {
+                    best = solution;
+                    score = SCORE_BEST;
+                    emit_progress(iter + 1, num_routes, best, true);
+                } else {
+                    score = candidate < current ? SCORE_BETTER : SCORE_ACCEPTED;
+                }
+                current = candidate;
+                for (int pickup_id : removed) {
+                    route_of[pickup_id] = route_of[instance.nodes[pickup_id].delivery_pair] = -1;
+                }
+                for (const auto &backup : backups) {
+                    for (int node_id : engine.routes[backup.first])
+                        route_of[node_id] = backup.first;
+                }
+            } else {
+                for (const auto &backup : backups) {
+                    engine.set_route(backup.first, backup.second);
+                }
+                engine.unrouted = previous_unrouted;
+            }
+
+            destroy_scores[destroy] += score;
+            repair_scores[repair] += score;
+            destroy_uses[destroy]++;
+            repair_uses[repair]++;
+            if ((iter + 1) % SEGMENT == 0) {
+                adapt(destroy_weights, destroy_scores, destroy_uses);
+                adapt(repair_weights, repair_scores, repair_uses);
+            }
+            temperature *= cooling;
+        }
+
+        double elapsed_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        cout << "ALNS: " << iter << " iterations (" << (elapsed_ms > 0 ? 1000.0 * iter / elapsed_ms : 0.0)
+             << "/s), best cost " << best.total_cost << ", routes " << best.used_routes << "; destroy weights";
+        for (double w : destroy_weights)
+            cout << " " << w;
+        cout << ", repair weights";
+        for (double w : repair_weights)
+            cout << " " << w;
+        cout << endl;
+        return best;
+    }
+
+private:
+    enum { DESTROY_RANDOM, DESTROY_WORST, DESTROY_SHAW, DESTROY_ROUTE, DESTROY_COUNT };
+    static const int REPAIR_COUNT = 3; // regret 1 (cheapest), 2 and 3
+    static const int SEGMENT = 100;
+    static constexpr double REACTION = 0.1;
+    static constexpr double SCORE_BEST = 33;
+    static constexpr double SCORE_BETTER = 9;
+    static constexpr double SCORE_ACCEPTED = 13;
+
+    mt19937 &gen;
+    InsertionEngine engine;
+    long long unserved_penalty = 0;
+    vector<int> route_of; // node id -> route, -1 if unrouted
+    vector<pair<int, vector<int>>> backups;
+    vector<char> touched;
+    vector<double> destroy_weights, repair_weights, destroy_scores, repair_scores;
+    vector<int> destroy_uses, repair_uses;
+
+    // Keeps a copy of route r as it was before this iteration
+    void touch(int r) {
+        if (!touched[r]) {
+            touched[r] = 1;
+            backups.push_back({r, engine.routes[r]});
+        }
+    }
+
+    // Inserts unrouted pairs while any fits, backing up the routes it changes
+    void complete(vector<char> *mark) {
+        int pickup_id;
+        while ((pickup_id = engine.select()) != -1) {
+            InsertionMove move = engine.best_move(pickup_id);
+            if (mark)
+                touch(move.route_idx);
+            engine.commit(pickup_id, move);
+        }
+    }
+
+    long long objective() const {
+        long long total = unserved_penalty * engine.unrouted.size();
+        for (int r = 0; r < engine.routes.size(); r++) {
+            total += engine.route_cost(r);
+        }
+        return total;
+    }
+
+    HybridSolution snapshot() const {
+        HybridSolution solution(engine.routes.size());
+        solution.routes = engine.routes;
+        for (int r = 0; r < engine.routes.size(); r++) {
+            if (engine.routes[r].empty())
+                continue;
+            solution.total_cost += engine.route_cost(r);
+            solution.used_routes++;
+            solution.served_pairs += engine.routes[r].size() / 2;
+        }
+        return solution;
+    }
+
+    int roulette(const vector<double> &weights) {
+        double r = uniform_real_distribution<>(0.0, accumulate(weights.begin(), weights.end(), 0.0))(gen);
+        for (int i = 0; i + 1 < weights.size(); i++) {
+            if ((r -= weights[i]) < 0)
+                return i;
+        }
+        return weights.size() - 1;
+    }
+
+    void adapt(vector<double> &weights, vector<double> &scores, vector<int> &uses) {
+        for (int i = 0; i < weights.size(); i++) {
+            if (uses[i] > 0)
+                weights[i] = max(0.05, (1 - REACTION) * weights[i] + REACTION * scores[i] / uses[i]);
+            scores[i] = 0;
+            uses[i] = 0;
+        }
+    }
+
+    // Index into a list sorted best first, biased towards its head
+    int biased_index(int size, double power) {
+        return min(size - 1, (int)(pow(uniform_real_distribution<>(0.0, 1.0)(gen), power) * size));
+    }
+
+    int shaw_relatedness(int a, int b) const {
+        const Node &pa = instance.nodes[a], &pb = instance.nodes[b];
+        const Node &da = instance.nodes[pa.delivery_pair], &db = instance.nodes[pb.delivery_pair];
+        return 9 * (instance.travel_times[a][b] + instance.travel_times[pa.delivery_pair][pb.delivery_pair]) +
+               3 * (abs(pa.early_time - pb.early_time) + abs(da.early_time - db.early_time)) +
+               2 * abs(pa.demand - pb.demand);
+    }
+
+    // Travel time saved by taking the pair out of its route
+    int removal_saving(int pickup_id, const vector<int> &position) const {
+        const vector<int> &route = engine.routes[route_of[pickup_id]];
+        int delivery_id = instance.nodes[pickup_id].delivery_pair;
+        int p = position[pickup_id], d = position[delivery_id];
+        auto at = [&](int k) { return k < 0 || k >= (int)route.size() ? 0 : route[k]; };
+        const Matrix<int> &t = instance.travel_times;
+        if (d == p + 1)
+            return t[at(p - 1)][pickup_id] + t[pickup_id][delivery_id] + t[delivery_id][at(d + 1)] -
+                   t[at(p - 1)][at(d + 1)];
+        return t[at(p - 1)][pickup_id] + t[pickup_id][at(p + 1)] - t[at(p - 1)][at(p + 1)] +
+               t[at(d - 1)][delivery_id] + t[delivery_id][at(d + 1)] - t[at(d - 1)][at(d + 1)];
+    }
+
+    vector<int> choose_removal(int destroy) {
+        vector<int> served;
+        for (const Node &pickup : pickup_nodes) {
+            if (route_of[pickup.id] != -1 && !is_locked(pickup.id) && !is_locked(pickup.delivery_pair))
+                served.push_back(pickup.id);
+        }
+        if (served.empty())
+            return served;
+        int q_max = max(1, min<int>(60, served.size() * 2 / 5));
+        int q = uniform_int_distribution<int>(min(4, q_max), q_max)(gen);
+        vector<int> removed;
+
+        if (destroy == DESTROY_RANDOM) {
+            shuffle(served.begin(), served.end(), gen);
+            removed.assign(served.begin(), served.begin() + q);
+        } else if (destroy == DESTROY_WORST) {
+            vector<int> position(instance.size, -1);
+            for (const auto &route : engine.routes) {
+                for (int k = 0; k < route.size(); k++)
+                    position[route[k]] = k;
+            }
+            vector<pair<int, int>> savings;
+            for (int pickup_id : served)
+                savings.push_back({-removal_saving(pickup_id, position), pickup_id});
+            sort(savings.begin(), savings.end());
+            while (removed.size() < q) {
+                int k = biased_index(savings.size(), 3);
+                removed.push_back(savings[k].second);
+                savings.erase(savings.begin() + k);
+            }
+        } else if (destroy == DESTROY_SHAW) {
+            int seed = uniform_int_distribution<int>(0, served.size() - 1)(gen);
+            removed.push_back(served[seed]);
+            served.erase(served.begin() + seed);
+            while (removed.size() < q && !served.empty()) {
+                int from = removed[uniform_int_distribution<int>(0, removed.size() - 1)(gen)];
+                sort(served.begin(), served.end(), [&](int a, int b) {
+                    return shaw_relatedness(from, a) < shaw_relatedness(from, b);
+                });
+                int k = biased_index(served.size(), 6);
+                removed.push_back(served[k]);
+                served.erase(served.begin() + k);
+            }
+        } else {
+            int r = route_of[served[uniform_int_distribution<int>(0, served.size() - 1)(gen)]];
+            for (int node_id : engine.routes[r]) {
+                if (instance.nodes[node_id].is_pickup() && !is_locked(node_id) &&
+                    !is_locked(instance.nodes[node_id].delivery_pair))
+                    removed.push_back(node_id);
+            }
+        }
+        return removed;
+    }
+};
+
+// Runs the ALNS on a solution with alns_iterations iterations
+HybridSolution alns_improve(const HybridSolution &solution) {
+    AlnsSearch search(worker_pool->rng(0));
+    return search.run(solution, hybrid_params.alns_iterations);
+}
+
+// One colony iteration: num_ants ant solutions (local search applied with
+// probability local_search_prob), ranked best first, then the trail update.
+// Ants run on the worker pool, or in turn on the given generator when the
+// caller already is a pool task (island mode). Returns the iteration's best
+// solution, which stays valid until the next iteration, or null without ants.
+const HybridSolution *colony_iteration(Colony &colony, int num_routes, mt19937 *rng = nullptr) {
+    PROFILE_SCOPE(PHASE_COLONY_ITERATION);
+    const HybridParams &params = colony.params;
+
+    // Each ant writes only its own slot, so workers need no locking
+    colony.solutions.resize(params.num_ants, HybridSolution(0));
+
+    auto run_ant = [&](int ant, mt19937 &gen) {
+        HybridSolution &solution = colony.solutions[ant];
+        solution.reset(num_routes);
+        if (solve_should_stop())
+            return;
+        HybridAnt hybrid_ant(colony, gen);
+        hybrid_ant.construct_solution(num_routes, solution);
+
+        // Apply local search occasionally
+        if (uniform_real_distribution<>(0.0, 1.0)(gen) < params.local_search_prob) {
+            local_search_in_place(solution);
+        }
+    };
+
+    // Generate solutions with hybrid ants
+    if (rng) {
+        for (int ant = 0; ant < params.num_ants; ant++) {
+            run_ant(ant, *rng);
+        }
+    } else {
+        WorkerPool &pool = *worker_pool;
+        pool.run(params.num_ants, [&](int ant, int worker) { run_ant(ant, pool.rng(worker)); });
+    }
+
+    // Rank by quality
+    colony.ranking.resize(params.num_ants);
+    iota(colony.ranking.begin(), colony.ranking.end(), 0);
+    sort(colony.ranking.begin(), colony.ranking.end(),
+         [&](int a, int b) { return colony.solutions[a] < colony.solutions[b]; });
+
+    // Update pheromone
+    update_pheromone(colony);
+    return colony.ranking.empty() ? nullptr : &colony.solutions[colony.ranking[0]];
+}
+
+// Elite pool for path relinking. Unlike the iteration's ranked ants, the pool
+// keeps good solutions across iterations, and it keeps them spread out.
+// Solutions are compared by their pair-to-route assignment: the distance is
+// the number of pairs outside the routes two solutions have in common.
+// A newcomer closer than min_distance to a member may only replace that
+// member. Otherwise it fills a free slot or replaces the worst member.
+
+// Route of every pair (by pickup_index) in a solution, -1 if unserved
+void assign_pairs(const HybridSolution &solution, vector<int> &route_of) {
+    route_of.assign(pickup_nodes.size(), -1);
+    for (int r = 0; r < solution.routes.size(); r++) {
+        for (int node_id : solution.routes[r]) {
+            if (pickup_index[node_id] >= 0)
+                route_of[pickup_index[node_id]] = r;
+        }
+    }
+}
+
+// For each guide route, the base route it corresponds to. Routes are paired
+// greedily by the number of pairs they share, and guide routes left over
+// take the empty base routes. shared receives the pairs in paired routes.
+vector<int> match_routes(const vector<int> &base_of, const HybridSolution &base, const vector<int> &guide_of,
+                         const HybridSolution &guide, int &shared) {
+    int nb = base.routes.size(), ng = guide.routes.size();
+    vector<int> overlap((size_t)nb * ng, 0);
+    for (int k = 0; k < base_of.size(); k++) {
+        if (base_of[k] >= 0 && guide_of[k] >= 0)
+            overlap[(size_t)guide_of[k] * nb + base_of[k]]++;
+    }
+    vector<pair<int, int>> cells; // (-overlap, guide * nb + base)
+    for (int c = 0; c < overlap.size(); c++) {
+        if (overlap[c] > 0)
+            cells.push_back({-overlap[c], c});
+    }
+    sort(cells.begin(), cells.end());
+
+    vector<int> target(ng, -1);
+    vector<char> taken(nb, 0);
+    shared = 0;
+    for (auto [count, c] : cells) {
+        int g = c / nb, b = c % nb;
+        if (target[g] == -1 && !taken[b]) {
+            target[g] = b;
+            taken[b] = 1;
+            shared -= count;
+        }
+    }
+    int b = 0;
+    for (int g = 0; g < ng; g++) {
+        if (target[g] != -1 || guide.routes[g].empty())
+            continue;
+        while (b < nb && (taken[b] || !base.routes[b].empty()))
+            b++;
+        if (b == nb)
+            break;
+        target[g] = b;
+        taken[b] = 1;
+    }
+    return target;
+}
+
+struct ElitePool {
+    int capacity = 0;
+    int min_distance = 1;
+    vector<HybridSolution> members;
+    vector<vector<int>> route_of; // assign_pairs of each member
+
+    void reset(int size) {
+        capacity = size;
+        min_distance = max(1, (int)pickup_nodes.size() / 10);
+        members.clear();
+        route_of.clear();
+    }
+
+    int distance(const HybridSolution &solution, const vector<int> &solution_of, int member) const {
+        int shared;
+        match_routes(route_of[member], members[member], solution_of, solution, shared);
+        return (int)pickup_nodes.size() - shared;
+    }
+
+    // Whether the solution joined the pool
+    bool offer(const HybridSolution &solution) {
+        if (capacity <= 0 || solution.used_routes == 0)
+            return false;
+        vector<int> solution_of;
+        assign_pairs(solution, solution_of);
+        int closest = -1, closest_distance = INT_MAX, worst = -1;
+        for (int i = 0; i < members.size(); i++) {
+            int d = distance(solution, solution_of, i);
+            if (d < closest_distance) {
+                closest = i;
+                closest_distance = d;
+            }
+            if (worst == -1 || members[worst] < members[i])
+                worst = i;
+        }
+
+        int slot;
+        if (closest_distance < min_distance)
+            slot = solution < members[closest] ? closest : -1;
+        else if (members.size() < capacity)
+            slot = members.size();
+        else
+            slot = solution < members[worst] ? worst : -1;
+        if (slot == -1)
+            return false;
+        if (slot == members.size()) {
+            members.push_back(solution);
+            route_of.push_back(move(solution_of));
+        } else {
+            members[slot] = solution;
+            route_of[slot] = move(solution_of);
+        }
+        return true;
+    }
+};
+
+// Walks from start towards guide: pairs whose route differs move, in random
+// order, to the start route matching their guide route, each at its cheapest
+// feasible position. The best solution in the middle half of the walk goes
+// through local search into result; nearer the ends, local search would
+// mostly lead back to start or guide. False when there was no such solution.
+bool path_relink(const HybridSolution &start, const vector<int> &start_of, const HybridSolution &guide,
+                 const vector<int> &guide_of, mt19937 &gen, HybridSolution &result) {
+    PROFILE_SCOPE(PHASE_PATH_RELINK);
+    int shared;
+    vector<int> target = match_routes(start_of, start, guide_of, guide, shared);
+    vector<int> current_of = start_of;
+    vector<int> moves;
+    for (int k = 0; k < start_of.size(); k++) {
+        int g = guide_of[k];
+        if (start_of[k] >= 0 && g >= 0 && target[g] >= 0 && target[g] != start_of[k] &&
+            !is_locked(pickup_nodes[k].id))
+            moves.push_back(k);
+    }
+    shuffle(moves.begin(), moves.end(), gen);
+
+    HybridSolution current = start;
+    RouteState state;
+    vector<int> reduced;
+    bool found = false;
+    int steps = 0, first_step = max(1, (int)moves.size() / 4), last_step = moves.size() - moves.size() / 4;
+    for (int k : moves) {
+        if (solve_should_stop())
+            break;
+        int pickup_id = pickup_nodes[k].id;
+        int delivery_id = pickup_nodes[k].delivery_pair;
+        int from = current_of[k], to = target[guide_of[k]];
+
+        reduced.clear();
+        for (int node_id : current.routes[from]) {
+            if (node_id != pickup_id && node_id != delivery_id)
+                reduced.push_back(node_id);
+        }
+        if (!is_feasible_route(reduced))
+            continue;
+        state.build(current.routes[to]);
+        InsertionMove move;
+        int first_pos = first_free_position(current.routes[to]);
+        if (!best_insertion_in_route(state, to, pickup_id, delivery_id, move, false, first_pos))
+            continue;
+
+        current.routes[from].swap(reduced);
+        apply_insertion(current.routes[to], pickup_id, delivery_id, move.pickup_pos, move.delivery_pos);
+        current_of[k] = to;
+        if (++steps < first_step)
+            continue;
+        if (steps > last_step)
+            break;
+        current.calculate_cost();
+        if (!found || current < result) {
+            result = current;
+            found = true;
+        }
+    }
+
+    if (found)
+        local_search_in_place(result);
+    return found;
+}
+
+// One round of path relinking, one relink per pool worker between two
+// members drawn at random. Results are offered back to the pool, and those
+// that join it deposit on the trails. A result better than best (or any
+// result while found is false) replaces it. Returns whether any result
+// joined the pool.
+bool relink_elites(ElitePool &pool, Colony &colony, HybridSolution &best, bool &found) {
+    int size = pool.members.size();
+    if (size < 2 || solve_should_stop())
+        return false;
+
+    WorkerPool &workers = *worker_pool;
+    int tasks = workers.size();
+    // Kept by the calling thread; the tasks reach it through this reference,
+    // as the name would resolve to each worker's own copy
+    thread_local vector<HybridSolution> result_slots;
+    vector<HybridSolution> &results = result_slots;
+    results.resize(tasks, HybridSolution(0));
+    vector<char> relinked(tasks, 0);
+    workers.run(tasks, [&](int task, int worker) {
+        mt19937 &gen = workers.rng(worker);
+        int a = uniform_int_distribution<int>(0, size - 1)(gen);
+        int b = uniform_int_distribution<int>(0, size - 2)(gen);
+        b += b >= a;
+        relinked[task] = path_relink(pool.members[a], pool.route_of[a], pool.members[b], pool.route_of[b], gen,
+                                     results[task]);
+    });
+
+    bool deposited = false;
+    for (int task = 0; task < tasks; task++) {
+        if (!relinked[task])
+            continue;
+        if (pool.offer(results[task])) {
+            deposit_pheromone(colony, results[task]);
+            deposited = true;
+        }
+        if (!found || results[task] < best) {
+            best = results[task];
+            found = true;
+        }
+    }
+    if (deposited)
+        refresh_attractiveness(colony);
+    return deposited;
+}
+
+// Runs the colony with num_routes vehicles. Without a warm start the trails
+// are reset and the search starts from pure greedy; with one, the current
+// trails are kept and the search starts from the given solution.
+HybridSolution hybrid_aco_solve(Colony &colony, int num_routes, const HybridSolution *warm_start = nullptr) {
+    const HybridParams &params = colony.params;
+    HybridSolution best_solution(num_routes);
+
+    if (warm_start) {
+        best_solution = *warm_start;
+    } else {
+        // Start with pure greedy solution
+        best_solution.routes = pure_greedy_insertion(num_routes);
+        best_solution.calculate_cost();
+        initialize_pheromone(colony, best_solution.routes);
+    }
+
+    cout << "Starting Simplified Hybrid ACO-Greedy..." << endl;
+    cout << "Initial " << (warm_start ? "warm-start" : "greedy") << " solution cost: " << best_solution.total_cost
+         << endl;
+    cout << "Pheromone trails: " << (colony.pheromone.sparse() ? "sparse" : "dense") << ", "
+         << colony.pheromone.stored_edges() << " edges, " << colony.pheromone.memory_bytes() / 1024 << " KB" << endl;
+    emit_progress(0, num_routes, best_solution, true);
+
+    ElitePool pool;
+    pool.reset(params.elite_pool);
+    pool.offer(best_solution);
+    HybridSolution relinked(0);
+
+    int no_improvement_count = 0;
+
+    for (int iter = 0; iter < params.max_iterations; iter++) {
+        if (solve_should_stop()) {
+            cout << "Stopping at iteration " << iter + 1 << " (" << stop_reason() << ")" << endl;
+            break;
+        }
+
+        const HybridSolution *iteration_best = colony_iteration(colony, num_routes);
+
+        // The iteration's elite ants are offered to the pool, then its members
+        // relinked for as long as the rounds renew it, up to one round per slot.
+        // Relinking costs far less than a colony iteration.
+        const char *source = "";
+        if (pool.capacity > 0) {
+            for (int rank = 0; rank < min(params.elite_solutions, (int)colony.ranking.size()); rank++)
+                pool.offer(colony.solutions[colony.ranking[rank]]);
+            bool found = false;
+            for (int round = 0; round < pool.capacity && relink_elites(pool, colony, relinked, found); round++) {
+            }
+            if (found && (!iteration_best || relinked < *iteration_best)) {
+                iteration_best = &relinked;
+                source = " (path relinking)";
+            }
+        }
+
+        // Update best solution
+        bool improved = iteration_best && *iteration_best < best_solution;
+        if (improved) {
+            best_solution = *iteration_best;
+            no_improvement_count = 0;
+            cout << "Iteration " << iter + 1 << ": New best cost = "
+                 << best_solution.total_cost << ", Routes used = "
+                 << best_solution.used_routes << source << endl;
+        } else {
+            no_improvement_count++;
+        }
+        emit_progress(iter + 1, num_routes, best_solution, improved);
+
+        // Early termination if no improvement
+        if (no_improvement_count >= params.restart_threshold) {
+            cout << "Early termination at iteration " << iter + 1 << endl;
+            break;
+        }
+    }
+
+    return best_solution;
+}
+
+// Island model: several colonies, each with its own trails, parameter variant
+// and random stream, evolve independently for migration_interval iterations
+// at a time as pool tasks. Between epochs every island sends its best solution
+// to the next one on a ring; the receiver adopts it if better, deposits it on
+// its trails and, with migration_blend > 0, mixes in that share of its
+// neighbour's trails. Islands seed their generators from the solve seed and
+// their index, so results do not depend on the thread count.
+struct Island {
+    Colony colony;
+    mt19937 rng;
+    HybridSolution best = HybridSolution(0);
+};
+
+// Island 0 keeps the given parameters; the others draw alpha, beta, rho,
+// greedy bias and local search probability around them
+HybridParams island_params(const HybridParams &base, int island) {
+    HybridParams params = base;
+    if (island == 0)
+        return params;
+
+    seed_seq seq{base.seed, 7919u, (unsigned)island};
+    mt19937 gen(seq);
+    uniform_real_distribution<> factor(0.5, 1.5);
+    uniform_real_distribution<> shift(-0.15, 0.15);
+    params.alpha = base.alpha * factor(gen);
+    params.beta = base.beta * factor(gen);
+    params.rho = min(0.9, max(0.01, base.rho * factor(gen)));
+    params.greedy_bias = min(0.98, max(0.5, base.greedy_bias + shift(gen)));
+    params.local_search_prob = min(1.0, max(0.1, base.local_search_prob + shift(gen)));
+    return params;
+}
+
+vector<Island> create_islands(const HybridParams &base) {
+    vector<Island> islands(max(1, base.islands));
+    for (int i = 0; i < islands.size(); i++) {
+        islands[i].colony.params = island_params(base, i);
+        seed_seq seq{base.seed, 1000u + i};
+        islands[i].rng.seed(seq);
+    }
+    return islands;
+}
+
+HybridSolution island_aco_solve(vector<Island> &islands, int num_routes, const HybridSolution *warm_start = nullptr) {
+    const HybridParams &params = hybrid_params;
+    int interval = max(1, params.migration_interval);
+    HybridSolution best_solution(num_routes);
+
+    if (warm_start) {
+        best_solution = *warm_start;
+    } else {
+        best_solution.routes = pure_greedy_insertion(num_routes);
+        best_solution.calculate_cost();
+        for (Island &island : islands) {
+            initialize_pheromone(island.colony, best_solution.routes);
+        }
+    }
+    for (Island &island : islands) {
+        island.best = best_solution;
+    }
+
+    cout << "Starting island model with " << islands.size() << " colonies, migration every " << interval
+         << " iterations..." << endl;
+    cout << "Initial " << (warm_start ? "warm-start" : "greedy") << " solution cost: " << best_solution.total_cost
+         << endl;
+    emit_progress(0, num_routes, best_solution, true);
+
+    int no_improvement_epochs = 0;
+    for (int done = 0; done < params.max_iterations; done += interval) {
+        if (solve_should_stop()) {
+            cout << "Stopping at iteration " << done + 1 << " (" << stop_reason() << ")" << endl;
+            break;
+        }
+
+        int epoch_iterations = min(interval, params.max_iterations - done);
+        worker_pool->run(islands.size(), [&](int i, int) {
+            Island &island = islands[i];
+            for (int iter = 0; iter < epoch_iterations && !solve_should_stop(); iter++) {
+                const HybridSolution *iteration_best = colony_iteration(island.colony, num_routes, &island.rng);
+                if (iteration_best && *iteration_best < island.best)
+                    island.best = *iteration_best;
+            }
+        });
+
+        // Ring migration of the epoch's island bests
+        int k = islands.size();
+        vector<HybridSolution> migrants;
+        for (const Island &island : islands) {
+            migrants.push_back(island.best);
+        }
+        // Every island blends with its neighbour's trails as they were before
+        // this migration, so the ring is the same all the way round
+        vector<PheromoneTrails> previous;
+        if (params.migration_blend > 0.0 && k > 1) {
+            for (const Island &island : islands) {
+                previous.push_back(island.colony.pheromone);
+            }
+        }
+        for (int i = 0; i < k; i++) {
+            Island &island = islands[i];
+            const HybridSolution &migrant = migrants[(i + k - 1) % k];
+            if (k > 1) {
+                if (migrant < island.best)
+                    island.best = migrant;
+                deposit_pheromone(island.colony, migrant);
+            }
+            if (!previous.empty())
+                island.colony.pheromone.blend(previous[(i + k - 1) % k], min(1.0, params.migration_blend));
+            refresh_attractiveness(island.colony);
+        }
+
+        int best_island = min_element(migrants.begin(), migrants.end()) - migrants.begin();
+        bool improved = migrants[best_island] < best_solution;
+        if (improved) {
+            best_solution = migrants[best_island];
+            no_improvement_epochs = 0;
+            cout << "Iteration " << done + epoch_iterations << ": New best cost = " << best_solution.total_cost
+                 << ", Routes used = " << best_solution.used_routes << " (island " << best_island << ")" << endl;
+        } else {
+            no_improvement_epochs++;
+        }
+        emit_progress(done + epoch_iterations, num_routes, best_solution, improved);
+
+        // Epochs are longer than iterations, so stagnation is judged per epoch
+        if (no_improvement_epochs >= params.restart_threshold) {
+            cout << "Early termination at iteration " << done + epoch_iterations << endl;
+            break;
+        }
+    }
+
+    return best_solution;
+}
+
+string format_solution(const HybridSolution &solution) {
+    ostringstream file;
+
+    file << "Instance name : " << instance.name << endl;
+    file << "Authors       : Pix" << endl;
+    file << "Date          : 2025" << endl;
+    file << "Reference     : Simplified Hybrid ACO + Pure Greedy" << endl;
+    file << "Solution" << endl;
+
+    int route_num = 1;
+    for (const auto &route : solution.routes) {
+        if (!route.empty()) {
+            file << "Route " << route_num << " : ";
+            for (int i = 0; i < route.size(); i++) {
+                if (i > 0)
+                    file << " ";
+                file << route[i];
+            }
+            file << endl;
+            route_num++;
+        }
+    }
+
+    return file.str();
+}
+
+// A route as driven: when each stop is reached, served and left, the load on
+// board after it, and its slack, i.e. how much later service there could
+// start without missing a later window or the depot's closing time
+struct StopSchedule {
+    int node;
+    int arrival;
+    int start;
+    int departure;
+    int load;
+    int slack;
+};
+
+struct RouteSchedule {
+    int cost = 0;      // travel time
+    int departure = 0; // from the depot
+    int arrival = 0;   // back at the depot
+    int max_load = 0;
+    vector<StopSchedule> stops;
+};
+
+// Routes leave the depot at time 0. Under a route duration limit they leave
+// as late as their windows allow without waiting, which is how the duration
+// is measured.
+RouteSchedule schedule_route(const vector<int> &route) {
+    RouteSchedule schedule;
+    if (route.empty())
+        return schedule;
+    if (constraint_profile.route_duration) {
+        RouteSegment seg = depot_start_segment();
+        for (int node_id : route)
+            seg = concat_segments(seg, node_segment(node_id));
+        seg = concat_segments(seg, node_segment(0));
+        schedule.departure = max(0, min(seg.earliest, seg.latest));
+    }
+
+    int time = schedule.departure;
+    int load = 0;
+    int prev = 0;
+    schedule.stops.reserve(route.size());
+    for (int node_id : route) {
+        const Node &node = instance.nodes[node_id];
+        int travel = instance.travel_times[prev][node_id];
+        StopSchedule stop;
+        stop.node = node_id;
+        stop.arrival = time + travel;
+        stop.start = max(stop.arrival, node.early_time);
+        stop.departure = time = stop.start + node.service_duration;
+        stop.load = load += node.demand;
+        schedule.cost += travel;
+        schedule.max_load = max(schedule.max_load, load);
+        schedule.stops.push_back(stop);
+        prev = node_id;
+    }
+    schedule.cost += instance.travel_times[prev][0];
+    schedule.arrival = time + instance.travel_times[prev][0];
+
+    // A stop can start later by the room in its own window, or by the next
+    // stop's slack plus the waiting there that absorbs the delay
+    int slack = instance.nodes[0].late_time - schedule.arrival;
+    for (int k = (int)schedule.stops.size() - 1; k >= 0; k--) {
+        StopSchedule &stop = schedule.stops[k];
+        int next_wait = k + 1 < schedule.stops.size() ? schedule.stops[k + 1].start - schedule.stops[k + 1].arrival : 0;
+        slack = min(instance.nodes[stop.node].late_time - stop.start, slack + next_wait);
+        stop.slack = slack;
+    }
+    return schedule;
+}
+
+// Routes of a solution in write_output format; other lines are ignored
+vector<vector<int>> parse_solution_routes(const string &text) {
+    vector<vector<int>> routes;
+    istringstream in(text);
+    string line;
+    while (getline(in, line)) {
+        size_t colon = line.find(':');
+        if (line.compare(0, 6, "Route ") != 0 || colon == string::npos)
+            continue;
+        istringstream nodes(line.substr(colon + 1));
+        vector<int> route;
+        int node_id;
+        while (nodes >> node_id)
+            route.push_back(node_id);
+        routes.push_back(move(route));
+    }
+    return routes;
+}
+
+atomic<uint64_t> next_instance_id(1);
+
+// Derives the arc filter, tightened time windows, constraint profile, depot
+// and pickup/delivery lists from the loaded instance. Candidate lists depend
+// on granular_k and are built by solve_colony.
+void prepare_instance() {
+    instance.id = next_instance_id++;
+    build_arc_filter();
+    constraint_profile = analyze_constraints(instance);
+    depot = instance.nodes[0];
+    candidates = CandidateLists();
+    pickup_heuristic.clear();
+    pickup_nodes.clear();
+    delivery_nodes.clear();
+    pickup_index.assign(instance.size, -1);
+
+    for (const Node &node : instance.nodes) {
+        if (node.is_pickup()) {
+            pickup_index[node.id] = pickup_nodes.size();
+            pickup_nodes.push_back(node);
+        } else if (node.is_delivery()) {
+            delivery_nodes.push_back(node);
+        }
+    }
+}
+
+// Everything solve_instance needs besides the parameters
+struct PreparedInstance {
+    Instance instance;
+    vector<Node> pickup_nodes;
+    vector<Node> delivery_nodes;
+    vector<int> pickup_index;
+    ArcFilter arcs;
+    ConstraintProfile constraints;
+    CandidateLists candidates;
+    vector<double> pickup_heuristic;
+};
+
+// Snapshot of the current globals; the matrix is shared rather than copied
+shared_ptr<PreparedInstance> capture_prepared_instance() {
+    instance.travel_times.share();
+    auto prepared = make_shared<PreparedInstance>();
+    prepared->instance = instance;
+    prepared->pickup_nodes = pickup_nodes;
+    prepared->delivery_nodes = delivery_nodes;
+    prepared->pickup_index = pickup_index;
+    prepared->arcs = arcs;
+    prepared->constraints = constraint_profile;
+    prepared->candidates = candidates;
+    prepared->pickup_heuristic = pickup_heuristic;
+    return prepared;
+}
+
+void activate_prepared_instance(const PreparedInstance &prepared) {
+    instance = prepared.instance;
+    depot = instance.nodes[0];
+    pickup_nodes = prepared.pickup_nodes;
+    delivery_nodes = prepared.delivery_nodes;
+    pickup_index = prepared.pickup_index;
+    arcs = prepared.arcs;
+    constraint_profile = prepared.constraints;
+    candidates = prepared.candidates;
+    pickup_heuristic = prepared.pickup_heuristic;
+}
+
+// Copies the calling thread's solver state to the other pool workers so the
+// ants they run see the same instance, parameters and deadline
+void share_solver_state() {
+    if (worker_pool->size() == 1)
+        return;
+    shared_ptr<PreparedInstance> prepared = capture_prepared_instance();
+    HybridParams params = hybrid_params;
+    auto start = solve_start;
+    auto deadline = solve_deadline;
+    worker_pool->run(worker_pool->size(), [&](int, int worker) {
+        if (worker == 0)
+            return;
+        activate_prepared_instance(*prepared);
+        hybrid_params = params;
+        solve_start = start;
+        solve_deadline = deadline;
+        deadline_reached = false;
+    });
+}
+
+// Solver logging goes through cout, whose buffer is replaced once in main by
+// this one. It forwards to target, except from threads that muted their own
+// logging (MuteLog), e.g. while benchmarks or subproblem solves run, so no
+// solve ever has to swap cout's buffer under other threads.
+thread_local int log_muted = 0;
+
+struct LogBuffer : streambuf {
+    streambuf *target = nullptr;
+
+    int overflow(int c) override { return log_muted || c == EOF ? c : target->sputc(c); }
+    streamsize xsputn(const char *s, streamsize n) override { return log_muted ? n : target->sputn(s, n); }
+    int sync() override { return log_muted ? 0 : target->pubsync(); }
+};
+
+LogBuffer log_buffer;
+
+struct MuteLog {
+    MuteLog() { log_muted++; }
+    ~MuteLog() { log_muted--; }
+};
+
+// Runs task(i) for every i < count on as many lanes as the pool has threads.
+// Each lane takes the next index as soon as it is free and runs it on a
+// single-thread pool of its own, so a task can be a whole solve with its own
+// solver state. The lanes are threads of their own with the caller as lane 0,
+// so the shared pool is idle meanwhile and its workers keep their state.
+void run_packed(int count, const function<void(int)> &task) {
+    atomic<int> next(0);
+    unsigned seed = hybrid_params.seed;
+    auto lane = [&] {
+        worker_pool = make_unique<WorkerPool>(1, seed);
+        for (int i; (i = next++) < count && !stop_requested;) {
+            task(i);
+        }
+    };
+
+    vector<thread> lanes;
+    for (int l = 1; l < min(count, worker_pool->size()); l++) {
+        lanes.emplace_back(lane);
+    }
+    unique_ptr<WorkerPool> shared_pool = move(worker_pool);
+    lane();
+    worker_pool = move(shared_pool);
+    for (thread &t : lanes) {
+        t.join();
+    }
+}
+
+// One vehicle count tried by fleet minimization
+struct FleetAttempt {
+    int routes;
+    bool aco; // false for a greedy feasibility probe
+    int served_pairs;
+    int used_routes;
+    int cost;
+    double elapsed_ms;
+};
+
+thread_local vector<FleetAttempt> fleet_attempts;
+
+void log_fleet_attempt(int num_routes, bool aco, const HybridSolution &solution,
+                       chrono::steady_clock::time_point start) {
+    FleetAttempt attempt = {num_routes, aco, solution.served_pairs, solution.used_routes, solution.total_cost,
+                            chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()};
+    fleet_attempts.push_back(attempt);
+    cout << "Fleet attempt " << fleet_attempts.size() << ": " << num_routes << " routes (" << (aco ? "ACO" : "greedy")
+         << "), served " << attempt.served_pairs << "/" << pickup_nodes.size() << " pairs, cost "
+         << attempt.cost << ", " << attempt.elapsed_ms << " ms" << endl;
+}
+
+// Warm start for num_routes vehicles: keeps the routes of `from` serving the
+// most nodes (dropping the shortest ones is the route elimination step), pads
+// with empty routes and greedily inserts every pair left out.
+HybridSolution reshape_solution(const HybridSolution &from, int num_routes) {
+    vector<vector<int>> routes;
+    for (const auto &route : from.routes) {
+        if (!route.empty())
+            routes.push_back(route);
+    }
+    stable_sort(routes.begin(), routes.end(),
+                [](const vector<int> &a, const vector<int> &b) { return a.size() > b.size(); });
+    routes.resize(num_routes);
+
+    HybridSolution solution(num_routes);
+    solution.routes = greedy_complete(routes);
+    solution.calculate_cost();
+    return solution;
+}
+
+// Fleet minimization. The colony first runs with the requested number of
+// routes. If that leaves pairs unserved, greedy completion of the best
+// partial solution with 1, 2, 4, ... extra routes brackets a feasible count,
+// and a binary search between the failed and the feasible count runs the
+// colony on the midpoints. Every attempt after the first keeps the trails and
+// starts from the better of the feasible and the partial solution reshaped to
+// its route count.
+HybridSolution solve_colony(int num_routes) {
+    if (candidates.k != hybrid_params.granular_k || pickup_heuristic.size() != pickup_nodes.size()) {
+        build_candidate_lists(hybrid_params.granular_k);
+        compute_pickup_heuristic();
+    }
+    share_solver_state();
+    // Ant routes run well past the fleet's average length
+    route_cache.fit(min(2 * pickup_nodes.size(), 8 * pickup_nodes.size() / max(1, num_routes)));
+
+    cout << "Nodes: " << instance.size << ", Pickup pairs: " << pickup_nodes.size() << endl;
+    cout << "Capacity: " << instance.capacity << endl;
+
+    auto fleet_start = chrono::steady_clock::now();
+    fleet_attempts.clear();
+
+    // Trails live across the fleet attempts
+    Colony colony;
+    colony.params = hybrid_params;
+    vector<Island> islands;
+    if (hybrid_params.islands > 1)
+        islands = create_islands(hybrid_params);
+
+    auto run_colony = [&](int routes, const HybridSolution *warm_start) {
+        auto start = chrono::steady_clock::now();
+        cout << "\nAttempting solution with " << routes << " routes..." << endl;
+        HybridSolution result = islands.empty() ? hybrid_aco_solve(colony, routes, warm_start)
+                                                : island_aco_solve(islands, routes, warm_start);
+        if (hybrid_params.alns_iterations > 0 && !solve_should_stop())
+            result = min(result, alns_improve(result));
+        log_fleet_attempt(routes, true, result, start);
+        return result;
+    };
+
+    HybridSolution partial = run_colony(num_routes, nullptr);
+    HybridSolution feasible = partial;
+    bool all_pairs_served = partial.serves_all();
+    int max_routes = max(num_routes, (int)pickup_nodes.size() * 2);
+
+    if (!all_pairs_served) {
+        cout << "Served " << partial.served_pairs << " out of " << pickup_nodes.size()
+             << " pairs. Searching for a feasible number of routes..." << endl;
+
+        int low = num_routes + 1;
+        int high = num_routes;
+        for (int extra = 1; high < max_routes; extra *= 2) {
+            high = min(max_routes, num_routes + extra);
+            auto start = chrono::steady_clock::now();
+            HybridSolution probe = reshape_solution(partial, high);
+            log_fleet_attempt(high, false, probe, start);
+            if (probe.serves_all()) {
+                feasible = probe;
+                all_pairs_served = true;
+                break;
+            }
+        }
+
+        if (all_pairs_served) {
+            bool optimized = false;
+            while (low < high && !solve_should_stop()) {
+                int mid = low + (high - low) / 2;
+                HybridSolution warm_start = min(reshape_solution(feasible, mid), reshape_solution(partial, mid));
+                HybridSolution result = run_colony(mid, &warm_start);
+                if (result.serves_all()) {
+                    feasible = result;
+                    optimized = true;
+                    high = mid;
+                } else {
+                    partial = result;
+                    low = mid + 1;
+                }
+            }
+
+            // The bracketing probe was greedy only; let the colony improve it
+            if (!optimized) {
+                HybridSolution warm_start = feasible;
+                warm_start.routes.resize(high);
+                feasible = run_colony(high, &warm_start);
+            }
+        }
+    }
+
+    double fleet_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - fleet_start).count();
+    cout << "\nFleet minimization: " << fleet_attempts.size() << " attempt(s), routes tried:";
+    for (const FleetAttempt &attempt : fleet_attempts) {
+        cout << " " << attempt.routes;
+    }
+    cout << ", " << fleet_ms << " ms" << endl;
+    if (strcmp(stop_reason(), "none") != 0) {
+        cout << "Search stopped early (" << stop_reason() << "), keeping the best solution found" << endl;
+    }
+
+    HybridSolution best_solution = all_pairs_served ? feasible : partial;
+    if (!all_pairs_served) {
+        cout << "WARNING: Could not serve all pairs even with " << max_routes << " routes." << endl;
+    } else {
+        cout << "\nAll pairs served successfully using " << best_solution.used_routes << " routes." << endl;
+        cout << "Total cost: " << best_solution.total_cost << endl;
+    }
+
+    return best_solution;
+}
+
+// Splits the pickup/delivery pairs into clusters of about target_pairs pairs:
+// k-means (k-means++ seeding) over pickup and delivery coordinates and
+// time-window midpoints, each feature scaled to unit variance so distance and
+// time weigh alike. Returns the pickup ids of every non-empty cluster.
+vector<vector<int>> partition_pairs(int target_pairs, unsigned seed) {
+    const int D = 6;
+    int m = pickup_nodes.size();
+    int k = max(1, (m + target_pairs - 1) / target_pairs);
+
+    vector<array<double, D>> features(m);
+    for (int i = 0; i < m; i++) {
+        const Node &p = pickup_nodes[i];
+        const Node &d = instance.nodes[p.delivery_pair];
+        features[i] = {p.lat, p.lon, d.lat, d.lon, (p.early_time + p.late_time) / 2.0,
+                       (d.early_time + d.late_time) / 2.0};
+    }
+    for (int f = 0; f < D; f++) {
+        double mean = 0, var = 0;
+        for (const auto &x : features)
+            mean += x[f] / m;
+        for (const auto &x : features)
+            var += (x[f] - mean) * (x[f] - mean) / m;
+        double scale = var > 0 ? 1.0 / sqrt(var) : 0.0;
+        for (auto &x : features)
+            x[f] = (x[f] - mean) * scale;
+    }
+    auto distance = [](const array<double, D> &a, const array<double, D> &b) {
+        double sum = 0;
+        for (int f = 0; f < D; f++)
+            sum += (a[f] - b[f]) * (a[f] - b[f]);
+        return sum;
+    };
+
+    mt19937 rng(seed);
+    vector<array<double, D>> centers = {features[uniform_int_distribution<int>(0, m - 1)(rng)]};
+    vector<double> nearest(m, DBL_MAX);
+    while (centers.size() < k) {
+        double total = 0;
+        for (int i = 0; i < m; i++) {
+            nearest[i] = min(nearest[i], distance(features[i], centers.back()));
+            total += nearest[i];
+        }
+        double r = uniform_real_distribution<double>(0.0, total)(rng);
+        int pick = 0;
+        while (pick < m - 1 && (r -= nearest[pick]) > 0)
+            pick++;
+        centers.push_back(features[pick]);
+    }
+
+    vector<int> assignment(m, -1);
+    for (int iter = 0; iter < 50; iter++) {
+        bool changed = false;
+        for (int i = 0; i < m; i++) {
+            int best = 0;
+            for (int c = 1; c < k; c++) {
+                if (distance(features[i], centers[c]) < distance(features[i], centers[best]))
+                    best = c;
+            }
+            changed |= assignment[i] != best;
+            assignment[i] = best;
+        }
+        if (!changed)
+            break;
+        vector<array<double, D>> sums(k, array<double, D>{});
+        vector<int> counts(k, 0);
+        for (int i = 0; i < m; i++) {
+            counts[assignment[i]]++;
+            for (int f = 0; f < D; f++)
+                sums[assignment[i]][f] += features[i][f];
+        }
+        for (int c = 0; c < k; c++) {
+            for (int f = 0; f < D && counts[c]; f++)
+                centers[c][f] = sums[c][f] / counts[c];
+        }
+    }
+
+    vector<vector<int>> clusters(k);
+    for (int i = 0; i < m; i++) {
+        clusters[assignment[i]].push_back(pickup_nodes[i].id);
+    }
+    clusters.erase(remove_if(clusters.begin(), clusters.end(), [](const vector<int> &c) { return c.empty(); }),
+                   clusters.end());
+    return clusters;
+}
+
+// The instance restricted to the depot and the given pairs, renumbered in
+// order (pickup, then its delivery). original_ids maps new ids back.
+Instance make_subinstance(const vector<int> &pickups, vector<int> &original_ids) {
+    original_ids = {0};
+    for (int pickup_id : pickups) {
+        original_ids.push_back(pickup_id);
+        original_ids.push_back(instance.nodes[pickup_id].delivery_pair);
+    }
+
+    Instance sub;
+    sub.name = instance.name;
+    sub.location = instance.location;
+    sub.size = original_ids.size();
+    sub.capacity = instance.capacity;
+    sub.route_time = instance.route_time;
+    sub.nodes.resize(sub.size);
+    sub.travel_times.assign(sub.size, sub.size);
+    for (int i = 0; i < sub.size; i++) {
+        Node node = instance.nodes[original_ids[i]];
+        node.id = i;
+        if (node.is_pickup())
+            node.delivery_pair = i + 1;
+        else if (node.is_delivery())
+            node.pickup_pair = i - 1;
+        sub.nodes[i] = node;
+        for (int j = 0; j < sub.size; j++) {
+            sub.travel_times[i][j] = instance.travel_times[original_ids[i]][original_ids[j]];
+        }
+    }
+    return sub;
+}
+
+// Cluster-first decomposition for large instances. The pairs are split into
+// clusters of about cluster_pairs pairs and every cluster is solved as an
+// instance of its own (fleet minimization and colony, one thread each, the
+// clusters packed onto the pool and given four fifths of any time budget).
+// The merged routes are then polished across clusters: routes are dropped
+// while greedy reinsertion still serves every pair, and the pair local search
+// relocates and exchanges pairs between routes on granular neighbourhoods
+// (granular_k, or 20 when it is off). Trails only ever exist per cluster.
+HybridSolution solve_decomposed(int num_routes) {
+    HybridParams params = hybrid_params;
+    int total_pairs = pickup_nodes.size();
+    vector<vector<int>> clusters = partition_pairs(params.cluster_pairs, params.seed);
+    // Largest first, so the long solves do not end up last on the pool
+    stable_sort(clusters.begin(), clusters.end(),
+                [](const vector<int> &a, const vector<int> &b) { return a.size() > b.size(); });
+    int k = clusters.size();
+    cout << "Nodes: " << instance.size << ", Pickup pairs: " << total_pairs << endl;
+    cout << "Decomposing into " << k << " clusters of about " << params.cluster_pairs << " pairs..." << endl;
+
+    vector<Instance> subproblems(k);
+    vector<vector<int>> original_ids(k);
+    for (int c = 0; c < k; c++) {
+        subproblems[c] = make_subinstance(clusters[c], original_ids[c]);
+    }
+
+    auto phase_start = chrono::steady_clock::now();
+    auto start = solve_start;
+    auto deadline = solve_deadline;
+    auto cluster_deadline = deadline == chrono::steady_clock::time_point::max()
+                                ? deadline
+                                : phase_start + (deadline - phase_start) * 4 / 5;
+    shared_ptr<PreparedInstance> whole = capture_prepared_instance();
+    auto sink = exchange(progress_sink, nullptr);
+    auto new_best = exchange(on_new_best, nullptr);
+
+    vector<HybridSolution> results(k, HybridSolution(0));
+    run_packed(k, [&](int c) {
+        MuteLog mute;
+        hybrid_params = params;
+        hybrid_params.cluster_pairs = 0;
+        hybrid_params.num_threads = 1;
+        hybrid_params.seed = params.seed + c;
+        worker_pool->reseed(hybrid_params.seed);
+        solve_start = start;
+        solve_deadline = cluster_deadline;
+        deadline_reached = false;
+        instance = move(subproblems[c]);
+        prepare_instance();
+
+        int routes = max(1, (int)ceil((double)num_routes * clusters[c].size() / total_pairs));
+        HybridSolution solution = solve_colony(routes);
+        for (auto &route : solution.routes) {
+            for (int &node : route)
+                node = original_ids[c][node];
+        }
+        results[c] = move(solution);
+    });
+
+    activate_prepared_instance(*whole);
+    hybrid_params = params;
+    solve_deadline = deadline;
+    deadline_reached = false;
+    share_solver_state();
+    progress_sink = move(sink);
+    on_new_best = move(new_best);
+    fleet_attempts.clear();
+
+    HybridSolution merged(0);
+    for (int c = 0; c < k; c++) {
+        cout << "Cluster " << c + 1 << ": " << clusters[c].size() << " pairs, " << results[c].used_routes
+             << " routes, cost " << results[c].total_cost << endl;
+        for (auto &route : results[c].routes) {
+            if (!route.empty())
+                merged.routes.push_back(move(route));
+        }
+    }
+    merged.calculate_cost();
+    cout << "Merged: " << merged.used_routes << " routes, cost " << merged.total_cost << " ("
+         << chrono::duration<double, milli>(chrono::steady_clock::now() - phase_start).count() << " ms)" << endl;
+
+    int polish_k = params.granular_k > 0 ? params.granular_k : 20;
+    if (candidates.k != polish_k)
+        build_candidate_lists(polish_k);
+
+    // Pairs a cluster could not serve get a chance in any route, then in new ones
+    for (int extra = 0; !merged.serves_all() && extra <= total_pairs - merged.served_pairs; extra++) {
+        if (extra > 0)
+            merged.routes.emplace_back();
+        merged.routes = greedy_complete(merged.routes);
+        merged.calculate_cost();
+    }
+
+    while (merged.used_routes > 1 && merged.serves_all() && !solve_should_stop()) {
+        HybridSolution fewer = reshape_solution(merged, merged.used_routes - 1);
+        if (!fewer.serves_all())
+            break;
+        merged = fewer;
+    }
+    cout << "After route elimination: " << merged.used_routes << " routes, cost " << merged.total_cost << endl;
+
+    merged = local_search_pairs(merged, params.local_search == 2);
+    emit_progress(0, merged.routes.size(), merged, true);
+
+    if (!merged.serves_all()) {
+        cout << "WARNING: Served " << merged.served_pairs << " out of " << total_pairs << " pairs." << endl;
+    } else {
+        cout << "\nAll pairs served successfully using " << merged.used_routes << " routes." << endl;
+        cout << "Total cost: " << merged.total_cost << endl;
+    }
+    return merged;
+}
+
+// Plan being re-optimized, set for one solve. Nodes whose service starts at
+// or before previous_lock_time are locked; -1 locks nothing.
+thread_local vector<vector<int>> previous_plan;
+thread_local int previous_lock_time = -1;
+
+// Incremental re-optimization: the previous plan is kept as a warm start,
+// pairs it does not serve (new orders) are inserted into it and the result
+// gets a short polish. Nodes already served at the lock time stay fixed.
+HybridSolution solve_incremental() {
+    auto phase_start = chrono::steady_clock::now();
+    if (candidates.k != hybrid_params.granular_k)
+        build_candidate_lists(hybrid_params.granular_k);
+
+    // Keep only pairs the updated instance still has, visited in order on one route
+    vector<int> seen(instance.size, -1);
+    HybridSolution solution(0);
+    for (const vector<int> &plan_route : previous_plan) {
+        int r = solution.routes.size();
+        for (int node_id : plan_route) {
+            if (node_id > 0 && node_id < instance.size && seen[node_id] == -1)
+                seen[node_id] = r;
+        }
+        vector<int> route;
+        for (int node_id : plan_route) {
+            if (node_id <= 0 || node_id >= instance.size || seen[node_id] != r)
+                continue;
+            const Node &node = instance.nodes[node_id];
+            int partner = node.is_pickup() ? node.delivery_pair : node.pickup_pair;
+            if ((!node.is_pickup() && !node.is_delivery()) || seen[partner] != r)
+                continue;
+            if (node.is_delivery() && find(route.begin(), route.end(), partner) == route.end())
+                continue;
+            route.push_back(node_id);
+        }
+        for (size_t i = 0; i < route.size(); i++) {
+            const Node &node = instance.nodes[route[i]];
+            if (node.is_pickup() && find(route.begin() + i, route.end(), node.delivery_pair) == route.end())
+                route.erase(route.begin() + i--);
+        }
+        solution.routes.push_back(move(route));
+    }
+
+    node_locks.assign(instance.size, LOCK_NONE);
+    int kept_pairs = 0, locked_nodes = 0;
+    for (vector<int> &route : solution.routes) {
+        int time = 0, prev = 0;
+        for (int node_id : route) {
+            const Node &node = instance.nodes[node_id];
+            time = max(time + instance.travel_times[prev][node_id], node.early_time);
+            if (time > previous_lock_time)
+                break;
+            node_locks[node_id] = LOCK_SERVED;
+            time += node.service_duration;
+            prev = node_id;
+        }
+        for (int node_id : route) {
+            const Node &node = instance.nodes[node_id];
+            if (node.is_delivery() && node_locks[node.pickup_pair] == LOCK_SERVED && node_locks[node_id] == LOCK_NONE)
+                node_locks[node_id] = LOCK_PINNED;
+        }
+        // A route the update broke keeps its locked nodes, its other pairs are reinserted
+        if (!is_feasible_route(route)) {
+            route.erase(remove_if(route.begin(), route.end(), [](int node_id) { return !is_locked(node_id); }),
+                        route.end());
+        }
+        for (int node_id : route) {
+            kept_pairs += instance.nodes[node_id].is_pickup();
+            locked_nodes += is_locked(node_id);
+        }
+    }
+    int total_pairs = pickup_nodes.size();
+    cout << "Nodes: " << instance.size << ", Pickup pairs: " << total_pairs << endl;
+    cout << "Previous plan: " << solution.routes.size() << " routes, " << kept_pairs << " pairs kept, "
+         << locked_nodes << " nodes locked, " << total_pairs - kept_pairs << " pairs to insert" << endl;
+
+    // New pairs go into the existing routes first, then into new ones
+    solution.calculate_cost();
+    for (int extra = 0; !solution.serves_all() && extra <= total_pairs - solution.served_pairs; extra++) {
+        if (extra > 0)
+            solution.routes.emplace_back();
+        solution.routes = greedy_complete(solution.routes);
+        solution.calculate_cost();
+    }
+    cout << "After insertion: " << solution.used_routes << " routes, cost " << solution.total_cost << " ("
+         << chrono::duration<double, milli>(chrono::steady_clock::now() - phase_start).count() << " ms)" << endl;
+
+    if (!solve_should_stop())
+        solution = min(solution, improve_solution(solution));
+    if (hybrid_params.alns_iterations > 0 && !solve_should_stop())
+        solution = min(solution, alns_improve(solution));
+    node_locks.clear();
+    emit_progress(0, solution.routes.size(), solution, true);
+
+    if (!solution.serves_all()) {
+        cout << "WARNING: Served " << solution.served_pairs << " out of " << total_pairs << " pairs." << endl;
+    } else {
+        cout << "\nAll pairs served successfully using " << solution.used_routes << " routes." << endl;
+        cout << "Total cost: " << solution.total_cost << " ("
+             << chrono::duration<double, milli>(chrono::steady_clock::now() - phase_start).count() << " ms)"
+             << endl;
+    }
+    return solution;
+}
+
+// Entry point for a prepared instance: incremental when a previous plan is
+// set, decomposed when cluster_pairs is set and the instance has more pairs
+// than that, whole otherwise
+HybridSolution solve_instance(int num_routes) {
+    PROFILE_SCOPE(PHASE_SOLVE);
+    if (!previous_plan.empty())
+        return solve_incremental();
+    if (hybrid_params.cluster_pairs > 0 && (int)pickup_nodes.size() > hybrid_params.cluster_pairs)
+        return solve_decomposed(num_routes);
+    return solve_colony(num_routes);
+}
+
+// Stats block for a finished solve: the result, the fleet attempts and, when
+// instrumentation is compiled in, per-phase timings and event counters summed
+// over all threads
+string profile_stats_json(const HybridSolution &solution) {
+    ostringstream out;
+    out << "{\"instance\":" << json_escape(instance.name) << ",\"nodes\":" << instance.size
+        << ",\"threads\":" << hybrid_params.num_threads << ",\"seed\":" << hybrid_params.seed
+        << ",\"elapsed_ms\":" << solve_elapsed_ms() << ",\"cost\":" << solution.total_cost
+        << ",\"routes_used\":" << solution.used_routes << ",\"served_pairs\":" << solution.served_pairs
+        << ",\"stopped\":\"" << stop_reason() << "\",\"fleet_attempts\":[";
+    for (size_t i = 0; i < fleet_attempts.size(); i++) {
+        const FleetAttempt &attempt = fleet_attempts[i];
+        out << (i ? "," : "") << "{\"routes\":" << attempt.routes << ",\"aco\":" << (attempt.aco ? "true" : "false")
+            << ",\"served_pairs\":" << attempt.served_pairs << ",\"cost\":" << attempt.cost
+            << ",\"elapsed_ms\":" << attempt.elapsed_ms << "}";
+    }
+    long long cache_hits, cache_misses;
+    size_t cache_entries;
+    route_cache.counters(cache_hits, cache_misses, cache_entries);
+    out << "],\"arcs\":{\"total\":" << (long long)instance.size * (instance.size - 1)
+        << ",\"eliminated\":" << arcs.eliminated << ",\"windows_tightened\":" << arcs.windows_tightened << "}";
+    out << ",\"constraints\":{\"capacity\":" << (constraint_profile.capacity ? "true" : "false")
+        << ",\"service_times\":" << (constraint_profile.service_times ? "true" : "false")
+        << ",\"route_duration\":" << (constraint_profile.route_duration ? "true" : "false") << "}";
+    out << ",\"route_cache\":{\"hits\":" << cache_hits << ",\"misses\":" << cache_misses
+        << ",\"entries\":" << cache_entries << "}";
+#ifdef PDPTW_PROFILE
+    ProfileThread total = profiler.total();
+    out << ",\"profiling\":true,\"phases\":{";
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        double total_ms = total.phase_ns[p] / 1e6;
+        out << (p ? "," : "") << "\"" << PROFILE_PHASE_NAMES[p] << "\":{\"calls\":" << total.phase_calls[p]
+            << ",\"total_ms\":" << total_ms << ",\"mean_us\":"
+            << (total.phase_calls[p] ? 1000.0 * total_ms / total.phase_calls[p] : 0.0) << "}";
+    }
+    out << "},\"counters\":{";
+    for (int c = 0; c < COUNT_COUNTERS; c++) {
+        out << (c ? "," : "") << "\"" << PROFILE_COUNTER_NAMES[c] << "\":" << total.counters[c];
+    }
+    out << "}";
+#else
+    out << ",\"profiling\":false";
+#endif
+    out << "}";
+    return out.str();
+}
+
+enum OutputFormat { OUTPUT_TEXT, OUTPUT_JSON, OUTPUT_BINARY };
+
+bool parse_output_format(const string &name, OutputFormat &format) {
+    if (name == "text")
+        format = OUTPUT_TEXT;
+    else if (name == "json")
+        format = OUTPUT_JSON;
+    else if (name == "binary")
+        format = OUTPUT_BINARY;
+    else
+        return false;
+    return true;
+}
+
+// The solution with per-stop schedules, totals and the stats block, so
+// clients need not replay the routes against the instance
+string format_solution_json(const HybridSolution &solution) {
+    ostringstream out;
+    out << "{\"instance\":" << json_escape(instance.name) << ",\"total_cost\":" << solution.total_cost
+        << ",\"routes_used\":" << solution.used_routes << ",\"served_pairs\":" << solution.served_pairs
+        << ",\"total_pairs\":" << pickup_nodes.size() << ",\"routes\":[";
+    int route_num = 0;
+    for (const auto &route : solution.routes) {
+        if (route.empty())
+            continue;
+        RouteSchedule schedule = schedule_route(route);
+        route_num++;
+        out << (route_num > 1 ? "," : "") << "{\"route\":" << route_num << ",\"cost\":" << schedule.cost
+            << ",\"departure\":" << schedule.departure << ",\"return\":" << schedule.arrival
+            << ",\"max_load\":" << schedule.max_load << ",\"stops\":[";
+        for (size_t k = 0; k < schedule.stops.size(); k++) {
+            const StopSchedule &stop = schedule.stops[k];
+            out << (k ? "," : "") << "{\"node\":" << stop.node << ",\"arrival\":" << stop.arrival
+                << ",\"start\":" << stop.start << ",\"departure\":" << stop.departure << ",\"load\":" << stop.load
+                << ",\"slack\":" << stop.slack << "}";
+        }
+        out << "]}";
+    }
+    out << "],\"stats\":" << profile_stats_json(solution) << "}";
+    return out.str();
+}
+
+// Binary solution (little-endian): header, then for each route a BinaryRoute
+// followed by its stops, then stats_length bytes of the stats JSON
+const char BINARY_SOLUTION_MAGIC[8] = {'P', 'D', 'P', 'T', 'W', 'S', 'O', 'L'};
+const uint32_t BINARY_SOLUTION_VERSION = 1;
+
+struct BinarySolutionHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t routes;
+    int32_t stops;
+    int32_t total_cost;
+    int32_t served_pairs;
+    int32_t total_pairs;
+    uint32_t stats_length;
+    int32_t reserved;
+    double elapsed_ms;
+    char name[64];
+};
+
+struct BinaryRoute {
+    int32_t stops;
+    int32_t cost;
+    int32_t departure;
+    int32_t arrival;
+    int32_t max_load;
+    int32_t reserved;
+};
+
+struct BinaryStop {
+    int32_t node;
+    int32_t arrival;
+    int32_t start;
+    int32_t departure;
+    int32_t load;
+    int32_t slack;
+};
+
+static_assert(sizeof(BinarySolutionHeader) == 112, "binary solution header layout changed");
+static_assert(sizeof(BinaryRoute) == 24 && sizeof(BinaryStop) == 24, "binary solution layout changed");
+
+string format_solution_binary(const HybridSolution &solution) {
+    vector<RouteSchedule> schedules;
+    BinarySolutionHeader header = {};
+    memcpy(header.magic, BINARY_SOLUTION_MAGIC, sizeof(header.magic));
+    header.version = BINARY_SOLUTION_VERSION;
+    for (const auto &route : solution.routes) {
+        if (!route.empty()) {
+            schedules.push_back(schedule_route(route));
+            header.stops += route.size();
+        }
+    }
+    string stats = profile_stats_json(solution);
+    header.routes = schedules.size();
+    header.total_cost = solution.total_cost;
+    header.served_pairs = solution.served_pairs;
+    header.total_pairs = pickup_nodes.size();
+    header.stats_length = stats.size();
+    header.elapsed_ms = solve_elapsed_ms();
+    strncpy(header.name, instance.name.c_str(), sizeof(header.name) - 1);
+
+    string out;
+    out.reserve(sizeof(header) + schedules.size() * sizeof(BinaryRoute) + header.stops * sizeof(BinaryStop) +
+                stats.size());
+    auto append = [&out](const auto &record) { out.append(reinterpret_cast<const char *>(&record), sizeof(record)); };
+    append(header);
+    for (const RouteSchedule &schedule : schedules) {
+        append(BinaryRoute{(int32_t)schedule.stops.size(), schedule.cost, schedule.departure, schedule.arrival,
+                           schedule.max_load, 0});
+        for (const StopSchedule &stop : schedule.stops)
+            append(BinaryStop{stop.node, stop.arrival, stop.start, stop.departure, stop.load, stop.slack});
+    }
+    out += stats;
+    return out;
+}
+
+// Formats the whole solution first and writes it in one call; "-" is stdout
+void write_output(const string &filename, const HybridSolution &solution, OutputFormat format = OUTPUT_TEXT) {
+    string data = format == OUTPUT_JSON     ? format_solution_json(solution) + "\n"
+                  : format == OUTPUT_BINARY ? format_solution_binary(solution)
+                                            : format_solution(solution);
+    if (filename == "-") {
+#ifdef _WIN32
+        if (format == OUTPUT_BINARY)
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        fwrite(data.data(), 1, data.size(), stdout);
+        fflush(stdout);
+        return;
+    }
+    ofstream file(filename, format == OUTPUT_BINARY ? ios::binary : ios::out);
+    file.write(data.data(), data.size());
+}
+
+// Chrome trace-event file (chrome://tracing, Perfetto) with one complete event
+// per timed scope and one track per thread
+void write_chrome_trace(const string &filename) {
+#ifdef PDPTW_PROFILE
+    ofstream file(filename);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const ProfileThread *thread : profiler.snapshot()) {
+        file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->tid
+             << ",\"args\":{\"name\":\"" << (thread->tid == 0 ? "main" : "worker " + to_string(thread->tid)) << "\"}}";
+        first = false;
+        for (const TraceEvent &event : thread->events) {
+            file << ",\n{\"name\":\"" << PROFILE_PHASE_NAMES[event.phase] << "\",\"cat\":\"solver\",\"ph\":\"X\",\"ts\":"
+                 << event.start_us << ",\"dur\":" << event.duration_us << ",\"pid\":1,\"tid\":" << thread->tid << "}";
+        }
+    }
+    file << "\n]}\n";
+    cout << "Trace written to " << filename << endl;
+#else
+    cout << "Warning: built with PDPTW_NO_PROFILE, no trace written to " << filename << endl;
+#endif
+}
+
+void solve(const string &input_file, const string &output_file, int num_routes, const string &trace_file = "",
+           OutputFormat output_format = OUTPUT_TEXT) {
+#ifdef PDPTW_PROFILE
+    profiler.reset();
+    profiler.tracing = !trace_file.empty();
+#endif
+    route_cache.reset_counters();
+    auto load_start = chrono::steady_clock::now();
+    string load_error;
+    if (!load_instance(input_file, instance, load_error)) {
+        cout << "Error: " << load_error << endl;
+        exit(1);
+    }
+    prepare_instance();
+    double load_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - load_start).count();
+
+    cout << "Instance loaded: " << instance.name << " (" << load_ms << " ms)" << endl;
+    cout << "Arc filter: " << arcs.eliminated << " of " << (long long)instance.size * (instance.size - 1)
+         << " arcs eliminated, " << arcs.windows_tightened << " time windows tightened" << endl;
+    cout << "Binding constraints: " << describe_constraints(constraint_profile) << endl;
 
-        // Update pheromone
-        update_pheromone(iteration_solutions);
+    HybridSolution best_solution = solve_instance(num_routes);
 
-        // Early termination if no improvement
-        if (no_improvement_count >= hybrid_params.restart_threshold) {
-            cout << "Early termination at iteration " << iter + 1 << endl;
+    write_output(output_file, best_solution, output_format);
+    cout << "Solution written to " << (output_file == "-" ? "stdout" : output_file) << endl;
+
+    // Stats next to the output: output.txt -> output.stats.json
+    if (output_file != "-") {
+        string stats_file = filesystem::path(output_file).replace_extension(".stats.json").string();
+        ofstream(stats_file) << profile_stats_json(best_solution) << "\n";
+        cout << "Stats written to " << stats_file << endl;
+    }
+    if (!trace_file.empty()) {
+        write_chrome_trace(trace_file);
+    }
+
+    if (progress_sink) {
+        ostringstream event;
+        event << "{\"event\":\"done\",\"cost\":" << best_solution.total_cost
+              << ",\"routes_used\":" << best_solution.used_routes << ",\"served_pairs\":" << best_solution.served_pairs
+              << ",\"elapsed_ms\":" << solve_elapsed_ms() << ",\"stopped\":\"" << stop_reason() << "\"}";
+        progress_sink(event.str());
+    }
+}
+
+// Daemon mode: newline-delimited JSON requests on stdin or a Unix domain
+// socket, one JSON response line per request. Request fields:
+//   id            echoed back verbatim
+//   instance      instance text (an optional parameter line first is allowed)
+//   instance_file path to a text or binary instance instead of inline text
+//   params        parameter line, overrides one inside the instance text
+//   seed          RNG seed for this solve
+//   previous      solution text to re-optimize: its routes are kept and only
+//                 the pairs they do not serve are inserted
+//   lock_time     with previous, nodes served by this time stay fixed
+//   format        "json" answers with the solution as a JSON object with
+//                 schedules instead of the text format
+// Parsed instances and their derived data are kept in an LRU cache keyed by
+// a hash of the instance content, so repeated solves skip loading entirely.
+
+// Splits a flat JSON object into key -> raw JSON value text
+bool parse_json_object(const string &text, map<string, string> &fields) {
+    size_t i = 0;
+    auto skip_ws = [&] {
+        while (i < text.size() && isspace((unsigned char)text[i]))
+            i++;
+    };
+    // Advances past one JSON value starting at i
+    auto skip_value = [&]() -> bool {
+        if (i >= text.size())
+            return false;
+        if (text[i] == '"') {
+            for (i++; i < text.size() && text[i] != '"'; i++) {
+                if (text[i] == '\\')
+                    i++;
+            }
+            return i++ < text.size();
+        }
+        if (text[i] == '{' || text[i] == '[') {
+            int depth = 0;
+            bool in_string = false;
+            for (; i < text.size(); i++) {
+                char c = text[i];
+                if (in_string) {
+                    if (c == '\\')
+                        i++;
+                    else if (c == '"')
+                        in_string = false;
+                } else if (c == '"') {
+                    in_string = true;
+                } else if (c == '{' || c == '[') {
+                    depth++;
+                } else if ((c == '}' || c == ']') && --depth == 0) {
+                    i++;
+                    return true;
+                }
+            }
+            return false;
+        }
+        while (i < text.size() && text[i] != ',' && text[i] != '}' && !isspace((unsigned char)text[i]))
+            i++;
+        return true;
+    };
+
+    skip_ws();
+    if (i >= text.size() || text[i] != '{')
+        return false;
+    i++;
+    skip_ws();
+    if (i < text.size() && text[i] == '}')
+        return true;
+
+    while (i < text.size()) {
+        skip_ws();
+        size_t key_start = i;
+        if (text[i] != '"' || !skip_value())
+            return false;
+        string key = text.substr(key_start + 1, i - key_start - 2);
+        skip_ws();
+        if (i >= text.size() || text[i] != ':')
+            return false;
+        i++;
+        skip_ws();
+        size_t value_start = i;
+        if (!skip_value())
+            return false;
+        fields[key] = text.substr(value_start, i - value_start);
+        skip_ws();
+        if (i < text.size() && text[i] == ',') {
+            i++;
+        } else {
+            return i < text.size() && text[i] == '}';
+        }
+    }
+    return false;
+}
+
+void append_utf8(string &out, unsigned code) {
+    if (code < 0x80) {
+        out += (char)code;
+    } else if (code < 0x800) {
+        out += (char)(0xC0 | (code >> 6));
+        out += (char)(0x80 | (code & 0x3F));
+    } else {
+        out += (char)(0xE0 | (code >> 12));
+        out += (char)(0x80 | ((code >> 6) & 0x3F));
+        out += (char)(0x80 | (code & 0x3F));
+    }
+}
+
+// Decodes a raw JSON string value; other values are returned unchanged
+string json_string_value(const string &raw) {
+    if (raw.size() < 2 || raw.front() != '"')
+        return raw;
+
+    string out;
+    out.reserve(raw.size());
+    for (size_t i = 1; i + 1 < raw.size(); i++) {
+        char c = raw[i];
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        c = raw[++i];
+        switch (c) {
+        case 'n': out += '\n'; break;
+        case 't': out += '\t'; break;
+        case 'r': out += '\r'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'u':
+            append_utf8(out, (unsigned)strtoul(raw.substr(i + 1, 4).c_str(), nullptr, 16));
+            i += 4;
             break;
+        default: out += c; break;
         }
     }
+    return out;
+}
 
-    return best_solution;
+uint64_t fnv1a_hash(string_view data, uint64_t hash = 1469598103934665603ULL) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
 }
 
-void write_output(const string &filename, const HybridSolution &solution) {
-    ofstream file(filename);
+class InstanceCache {
+public:
+    explicit InstanceCache(size_t capacity) : capacity(max<size_t>(1, capacity)) {}
 
-    file << "Instance name : " << instance.name << endl;
-    file << "Authors       : Pix" << endl;
-    file << "Date          : 2025" << endl;
-    file << "Reference     : Simplified Hybrid ACO + Pure Greedy" << endl;
-    file << "Solution" << endl;
+    shared_ptr<PreparedInstance> get(uint64_t key) {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            misses++;
+            return nullptr;
+        }
+        hits++;
+        order.splice(order.begin(), order, it->second);
+        return it->second->second;
+    }
 
-    int route_num = 1;
-    for (const auto &route : solution.routes) {
-        if (!route.empty()) {
-            file << "Route " << route_num << " : ";
-            for (int i = 0; i < route.size(); i++) {
-                if (i > 0)
-                    file << " ";
-                file << route[i];
+    void put(uint64_t key, shared_ptr<PreparedInstance> prepared) {
+        order.emplace_front(key, move(prepared));
+        index[key] = order.begin();
+        if (order.size() > capacity) {
+            index.erase(order.back().first);
+            order.pop_back();
+        }
+    }
+
+    long long hits = 0;
+    long long misses = 0;
+
+private:
+    size_t capacity;
+    list<pair<uint64_t, shared_ptr<PreparedInstance>>> order;
+    unordered_map<uint64_t, list<pair<uint64_t, shared_ptr<PreparedInstance>>>::iterator> index;
+};
+
+// Handles one NDJSON request. With "progress": true the colony's progress
+// events are passed to send_event, tagged with the request id, before the
+// response is returned.
+string handle_daemon_request(const string &line, InstanceCache &cache,
+                             const function<void(const string &)> &send_event = nullptr) {
+    auto start = chrono::steady_clock::now();
+    map<string, string> fields;
+    if (!parse_json_object(line, fields)) {
+        return "{\"success\":false,\"error\":\"Invalid JSON request\"}";
+    }
+
+    string id = fields.count("id") ? fields["id"] : "null";
+    auto fail = [&](const string &message) {
+        return "{\"id\":" + id + ",\"success\":false,\"error\":" + json_escape(message) + "}";
+    };
+
+    string text = json_string_value(fields["instance"]);
+    string file = json_string_value(fields["instance_file"]);
+    string param_line = json_string_value(fields["params"]);
+    if (text.empty() && file.empty()) {
+        return fail("Missing instance or instance_file");
+    }
+
+    // A leading parameter line is not part of the instance content; the
+    // three-number header of a Li & Lim instance is
+    string_view body = text;
+    size_t first = body.find_first_not_of(" \t\r\n");
+    if (first != string_view::npos && (isdigit((unsigned char)body[first]) || body[first] == '.')) {
+        size_t eol = body.find('\n', first);
+        string_view line = body.substr(first, eol == string_view::npos ? string_view::npos : eol - first);
+        if (is_parameter_line(line)) {
+            if (param_line.empty())
+                param_line = string(line);
+            body = eol == string_view::npos ? string_view() : body.substr(eol + 1);
+        }
+    }
+
+    uint64_t key;
+    if (!file.empty()) {
+#ifndef _WIN32
+        struct stat st;
+        if (stat(file.c_str(), &st) != 0) {
+            return fail("Cannot open instance_file " + file);
+        }
+        key = fnv1a_hash(to_string(st.st_size) + ":" + to_string(st.st_mtime), fnv1a_hash(file));
+#else
+        if (!ifstream(file)) {
+            return fail("Cannot open instance_file " + file);
+        }
+        key = fnv1a_hash(file);
+#endif
+    } else {
+        key = fnv1a_hash(body);
+    }
+
+    shared_ptr<PreparedInstance> prepared = cache.get(key);
+    bool cached = prepared != nullptr;
+    if (cached) {
+        activate_prepared_instance(*prepared);
+    } else {
+        string load_error;
+        if (file.empty()) {
+            instance = parse_instance_text(body);
+            if (!check_instance(instance, load_error))
+                return fail(load_error);
+        } else if (!load_instance(file, instance, load_error)) {
+            return fail(load_error);
+        }
+        if (instance.size == 0) {
+            return fail("Instance has no nodes");
+        }
+        prepare_instance();
+        prepared = capture_prepared_instance();
+        cache.put(key, prepared);
+    }
+
+    // Thread count and the --time-limit default outlive a request
+    int num_threads = hybrid_params.num_threads;
+    int time_limit_ms = hybrid_params.time_limit_ms;
+    hybrid_params = HybridParams();
+    hybrid_params.num_threads = num_threads;
+    hybrid_params.time_limit_ms = time_limit_ms;
+    int num_routes = parse_parameter_line(param_line);
+    hybrid_params.seed = fields.count("seed") ? (unsigned)safe_stoi(fields["seed"], 0) : random_device{}();
+    worker_pool->reseed(hybrid_params.seed);
+    if (fields.count("time_limit_ms"))
+        hybrid_params.time_limit_ms = max(0, safe_stoi(fields["time_limit_ms"], 0));
+    previous_plan = parse_solution_routes(json_string_value(fields["previous"]));
+    previous_lock_time = fields.count("lock_time") ? safe_stoi(fields["lock_time"], -1) : -1;
+    OutputFormat format = OUTPUT_TEXT;
+    if (fields.count("format") && (!parse_output_format(json_string_value(fields["format"]), format) ||
+                                   format == OUTPUT_BINARY)) {
+        return fail("Unsupported format, use text or json");
+    }
+    start_solve_clock(start);
+
+#ifdef PDPTW_PROFILE
+    profiler.reset();
+#endif
+    if (send_event && fields["progress"] == "true") {
+        progress_sink = [&](const string &event) { send_event("{\"id\":" + id + "," + event.substr(1)); };
+    }
+    HybridSolution solution = solve_instance(num_routes);
+    progress_sink = nullptr;
+    previous_plan.clear();
+    // Keep candidate lists built for this request's granular_k with the entry
+    if (prepared->candidates.k != candidates.k || prepared->pickup_heuristic.empty()) {
+        prepared->candidates = candidates;
+        prepared->pickup_heuristic = pickup_heuristic;
+    }
+    double elapsed_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    ostringstream out;
+    out << "{\"id\":" << id << ",\"success\":true,\"result\":"
+        << (format == OUTPUT_JSON ? format_solution_json(solution) : json_escape(format_solution(solution)))
+        << ",\"cost\":" << solution.total_cost << ",\"routes_used\":" << solution.used_routes
+        << ",\"cached\":" << (cached ? "true" : "false") << ",\"seed\":" << hybrid_params.seed
+        << ",\"fleet_attempts\":" << fleet_attempts.size() << ",\"stopped\":\"" << stop_reason() << "\""
+        << ",\"elapsed_ms\":" << elapsed_ms;
+    if (fields["stats"] == "true") {
+        out << ",\"stats\":" << profile_stats_json(solution);
+    }
+    out << "}";
+    return out.str();
+}
+
+void run_daemon_stream(istream &in, ostream &out, InstanceCache &cache) {
+    string line;
+    auto send_event = [&](const string &event) { out << event << "\n" << flush; };
+    while (!stop_requested && getline(in, line)) {
+        if (line.find_first_not_of(" \t\r") == string::npos)
+            continue;
+        out << handle_daemon_request(line, cache, send_event) << "\n" << flush;
+        cout << "Cache hits: " << cache.hits << ", misses: " << cache.misses << endl;
+    }
+}
+
+#ifndef _WIN32
+int run_daemon_socket(const string &socket_path, InstanceCache &cache) {
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (server < 0 || socket_path.size() >= sizeof(addr.sun_path)) {
+        cout << "Error: Cannot create socket " << socket_path << endl;
+        return 1;
+    }
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socket_path.c_str());
+    if (::bind(server, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(server, 16) != 0) {
+        cout << "Error: Cannot listen on " << socket_path << endl;
+        close(server);
+        return 1;
+    }
+    cout << "Listening on " << socket_path << endl;
+
+    // Connections are served one at a time; a client may send many requests
+    while (!stop_requested) {
+        int client = accept(server, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        auto send = [&](const string &message) {
+            for (size_t sent = 0; sent < message.size();) {
+                ssize_t w = write(client, message.data() + sent, message.size() - sent);
+                if (w <= 0)
+                    break;
+                sent += w;
             }
-            file << endl;
-            route_num++;
+        };
+        auto send_event = [&](const string &event) { send(event + "\n"); };
+
+        string pending;
+        char buf[65536];
+        ssize_t n;
+        while ((n = read(client, buf, sizeof(buf))) > 0) {
+            pending.append(buf, n);
+            size_t eol;
+            while ((eol = pending.find('\n')) != string::npos) {
+                string line = pending.substr(0, eol);
+                pending.erase(0, eol + 1);
+                if (line.find_first_not_of(" \t\r") == string::npos)
+                    continue;
+                send(handle_daemon_request(line, cache, send_event) + "\n");
+            }
+            if (stop_requested)
+                break;
         }
+        close(client);
     }
 
-    file.close();
+    close(server);
+    unlink(socket_path.c_str());
+    return 0;
 }
+#endif
+
+// Times nested-vector scalar loops against the flat matrix kernels for the
+// pheromone evaporation sweep and the row reductions of select_aco_pickup
+void run_matrix_microbench() {
+    auto time_ms = [](const function<void()> &fn, int reps) {
+        auto start = chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) {
+            fn();
+        }
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / reps;
+    };
+
+    mt19937 rng(12345);
+    uniform_int_distribution<int> dist(0, 120);
+    double checksum = 0.0;
+
+    cout << "n,kernel,nested_ms,flat_scalar_ms,flat_simd_ms" << endl;
+    for (int n : {100, 1000, 5000}) {
+        int reps = max(1, 20000000 / (n * n));
+
+        vector<vector<double>> nested_tau(n, vector<double>(n, 1.0));
+        vector<vector<int>> nested_time(n, vector<int>(n));
+        Matrix<double> tau(n, n, 1.0);
+        Matrix<int> times(n, n, 0);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                nested_time[i][j] = times[i][j] = dist(rng);
+            }
+        }
 
-void solve(const string &input_file, const string &output_file, int num_routes) {
-    instance = parse_input(input_file);
-    depot = instance.nodes[0];
-    pickup_nodes.clear();
-    delivery_nodes.clear();
+        double nested = time_ms([&] {
+            for (int i = 0; i < n; i++)
+                for (int j = 0; j < n; j++)
+                    nested_tau[i][j] = min(max(nested_tau[i][j] * 0.9, 0.01), 50.0);
+        }, reps);
+        double flat_scalar = time_ms([&] { scale_clamp_scalar(tau.data(), tau.padded_size(), 0.9, 0.01, 50.0); }, reps);
+        double flat_simd = time_ms([&] { scale_clamp(tau, 0.9, 0.01, 50.0); }, reps);
+        cout << n << ",evaporate_clamp," << nested << "," << flat_scalar << "," << flat_simd << endl;
+
+        nested = time_ms([&] {
+            for (int i = 0; i < n; i++) {
+                double a = 0.0, b = 0.0;
+                for (int j = 0; j < n; j++) {
+                    if (nested_time[i][j] > 0) {
+                        a += nested_tau[i][j];
+                        b += 1.0 / (nested_time[i][j] + 1.0);
+                    }
+                }
+                checksum += a + b;
+            }
+        }, reps);
+        flat_scalar = time_ms([&] {
+            for (int i = 0; i < n; i++) {
+                double a, b;
+                masked_row_sums_scalar(tau[i], times[i], n, a, b);
+                checksum += a + b;
+            }
+        }, reps);
+        flat_simd = time_ms([&] {
+            for (int i = 0; i < n; i++) {
+                double a, b;
+                masked_row_sums(tau, times, i, a, b);
+                checksum += a + b;
+            }
+        }, reps);
+        cout << n << ",row_sums," << nested << "," << flat_scalar << "," << flat_simd << endl;
+    }
+    cout << "checksum " << checksum << endl;
+}
 
-    for (const Node &node : instance.nodes) {
-        if (node.is_pickup()) {
-            pickup_nodes.push_back(node);
-        } else if (node.is_delivery()) {
-            delivery_nodes.push_back(node);
+// Solver kernel microbenchmarks in the style of google-benchmark: each body
+// runs in growing batches until a batch takes min_ms, and the time per call of
+// that batch is reported. Results can be written as google-benchmark JSON, so
+// its compare.py works against a saved baseline.
+struct MicroBenchmarkResult {
+    string name;
+    long long iterations;
+    double real_ns;
+    double cpu_ns;
+    double allocations; // heap allocations per iteration, -1 without PDPTW_COUNT_ALLOCATIONS
+};
+
+MicroBenchmarkResult run_microbenchmark(const string &name, const function<void()> &fn, double min_ms = 200.0) {
+    // One untimed call grows whatever buffers the body reuses
+    fn();
+    long long iterations = 1;
+    while (true) {
+        auto start = chrono::steady_clock::now();
+        clock_t cpu_start = clock();
+#ifdef PDPTW_COUNT_ALLOCATIONS
+        long long allocations_start = heap_allocations;
+#endif
+        for (long long i = 0; i < iterations; i++) {
+            fn();
+        }
+        double real_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        double cpu_ms = 1000.0 * (clock() - cpu_start) / CLOCKS_PER_SEC;
+        if (real_ms >= min_ms || iterations >= (1LL << 40)) {
+#ifdef PDPTW_COUNT_ALLOCATIONS
+            double allocations = (double)(heap_allocations - allocations_start) / iterations;
+#else
+            double allocations = -1;
+#endif
+            MicroBenchmarkResult result = {name, iterations, real_ms * 1e6 / iterations, cpu_ms * 1e6 / iterations,
+                                           allocations};
+            cout << left << setw(40) << name << right << setw(14) << fixed << setprecision(1) << result.real_ns
+                 << " ns" << setw(14) << result.cpu_ns << " ns" << setw(12) << iterations << setw(12)
+                 << result.allocations << endl;
+            cout.unsetf(ios::floatfield);
+            cout << setprecision(6);
+            return result;
         }
+        iterations = real_ms <= 0.01 ? iterations * 100 : max(iterations + 1, (long long)(iterations * min_ms * 1.4 / real_ms));
     }
+}
 
-    cout << "Instance loaded: " << instance.name << endl;
-    cout << "Nodes: " << instance.size << ", Pickup pairs: " << pickup_nodes.size() << endl;
-    cout << "Capacity: " << instance.capacity << endl;
+void write_microbenchmark_json(const string &filename, const vector<MicroBenchmarkResult> &results) {
+    ofstream file(filename);
+    file << "{\n  \"context\": {\"executable\": \"PDPTW_HYBRID_ACO_GREEDY_V3\", \"instance\": "
+         << json_escape(instance.name) << ", \"nodes\": " << instance.size
+         << ", \"num_cpus\": " << thread::hardware_concurrency() << "},\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const MicroBenchmarkResult &r = results[i];
+        file << "    {\"name\": " << json_escape(r.name) << ", \"run_name\": " << json_escape(r.name)
+             << ", \"run_type\": \"iteration\", \"iterations\": " << r.iterations << ", \"real_time\": " << r.real_ns
+             << ", \"cpu_time\": " << r.cpu_ns << ", \"time_unit\": \"ns\", \"allocations\": " << r.allocations
+             << "}" << (i + 1 < results.size() ? "," : "")
+             << "\n";
+    }
+    file << "  ]\n}\n";
+}
 
-    int required_pairs = pickup_nodes.size();
-    HybridSolution best_solution(num_routes);
-    bool all_pairs_served = false;
-    int current_routes = num_routes;
+// Feasibility check, insertion evaluation, both local searches and the
+// pheromone update on the loaded instance, starting from a greedy solution
+// Compares every pair removal seen through ReducedRoute with the route
+// actually rebuilt without the pair; returns the number of mismatches
+int check_reduced_routes(const vector<vector<int>> &routes, int &checked) {
+    int mismatches = 0;
+    checked = 0;
+    for (const vector<int> &route : routes) {
+        RouteState state;
+        state.build(route);
+        for (int i = 0; i < route.size(); i++) {
+            for (int j = i + 1; j < route.size(); j++) {
+                vector<int> rest;
+                for (int k = 0; k < route.size(); k++) {
+                    if (k != i && k != j)
+                        rest.push_back(route[k]);
+                }
+                RouteSegment expected = evaluate_route(rest).schedule;
+                RouteSegment reduced = ReducedRoute(state, i, j).whole();
+                checked++;
+                if (reduced.travel != expected.travel || reduced.duration != expected.duration ||
+                    reduced.feasible != expected.feasible || reduced.min_load != expected.min_load ||
+                    reduced.max_load != expected.max_load)
+                    mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
 
-    while (!all_pairs_served && current_routes <= required_pairs * 2) {
-        cout << "\nAttempting solution with " << current_routes << " routes..." << endl;
+// False when a steady-state benchmark allocated
+bool run_solver_microbench(const string &output_file) {
+    prepare_instance();
+    build_candidate_lists(hybrid_params.granular_k);
+    compute_pickup_heuristic();
+
+    HybridSolution solution(pickup_nodes.size());
+    solution.routes = pure_greedy_insertion(max(1, (int)pickup_nodes.size()));
+    solution.routes.erase(remove_if(solution.routes.begin(), solution.routes.end(),
+                                    [](const vector<int> &route) { return route.empty(); }),
+                          solution.routes.end());
+    solution.calculate_cost();
+    Colony colony;
+    colony.params = hybrid_params;
+    initialize_pheromone(colony, solution.routes);
+    if (solution.routes.empty()) {
+        cout << "No routes to benchmark on" << endl;
+        return true;
+    }
 
-        best_solution = hybrid_aco_solve(current_routes);
+    vector<RouteState> states(solution.routes.size());
+    for (int r = 0; r < states.size(); r++) {
+        states[r].build(solution.routes[r]);
+    }
 
-        int total_nodes_visited = 0;
-        for (const auto &route : best_solution.routes) {
-            total_nodes_visited += route.size();
+    size_t longest = 0;
+    for (const vector<int> &route : solution.routes)
+        longest = max(longest, route.size());
+    route_cache.fit(2 * longest);
+
+    cout << "Instance " << instance.name << ": " << instance.size << " nodes, " << solution.used_routes
+         << " greedy routes, cost " << solution.total_cost << endl;
+    int checked;
+    int mismatches = check_reduced_routes(solution.routes, checked);
+    cout << "Reduced route check: " << mismatches << " of " << checked << " removals mismatch" << endl;
+    cout << left << setw(40) << "Benchmark" << right << setw(17) << "Time" << setw(17) << "CPU" << setw(12)
+         << "Iterations" << setw(12) << "Allocs" << endl;
+
+    vector<MicroBenchmarkResult> results;
+    volatile long long sink = 0;
+    size_t next = 0;
+
+    results.push_back(run_microbenchmark("BM_is_feasible_route", [&] {
+        sink += is_feasible_route(solution.routes[next++ % solution.routes.size()]);
+    }));
+    results.push_back(run_microbenchmark("BM_is_feasible_route/generic", [&] {
+        sink += feasible_route_kernel<GenericPolicy>(solution.routes[next++ % solution.routes.size()]);
+    }));
+    results.push_back(run_microbenchmark("BM_evaluate_route", [&] {
+        sink += evaluate_route(solution.routes[next++ % solution.routes.size()]).cost;
+    }));
+    results.push_back(run_microbenchmark("BM_route_cache_get", [&] {
+        sink += route_cache.get(solution.routes[next++ % solution.routes.size()]).cost;
+    }));
+    results.push_back(run_microbenchmark("BM_RouteState_build", [&] {
+        RouteState state;
+        state.build(solution.routes[next++ % solution.routes.size()]);
+        sink += state.cost;
+    }));
+    results.push_back(run_microbenchmark("BM_evaluate_insertion", [&] {
+        const RouteState &state = states[next % states.size()];
+        const Node &pickup = pickup_nodes[(next / states.size()) % pickup_nodes.size()];
+        int p = next % (state.length + 1);
+        int d = p + (next / 7) % (state.length - p + 1);
+        int delta;
+        sink += state.evaluate_insertion(pickup.id, pickup.delivery_pair, p, d, delta);
+        next++;
+    }));
+    results.push_back(run_microbenchmark("BM_best_insertion_in_route", [&] {
+        int r = next % states.size();
+        const Node &pickup = pickup_nodes[(next / states.size()) % pickup_nodes.size()];
+        InsertionMove move;
+        sink += best_insertion_in_route(states[r], r, pickup.id, pickup.delivery_pair, move, candidates.enabled());
+        next++;
+    }));
+    results.push_back(run_microbenchmark("BM_best_insertion_in_route/generic", [&] {
+        int r = next % states.size();
+        const Node &pickup = pickup_nodes[(next / states.size()) % pickup_nodes.size()];
+        InsertionMove move;
+        sink += best_insertion_kernel<GenericPolicy>(states[r], r, pickup.id, pickup.delivery_pair, move,
+                                                     candidates.enabled(), 0);
+        next++;
+    }));
+    // Local search as the colony runs it, in place on a copy whose buffers stay
+    HybridSolution scratch = solution;
+    PairLocalSearch pair_search;
+    results.push_back(run_microbenchmark("BM_local_search_2opt", [&] {
+        scratch = solution;
+        improve_2opt(scratch);
+        sink += scratch.total_cost;
+    }));
+    results.push_back(run_microbenchmark("BM_local_search_pairs", [&] {
+        scratch = solution;
+        pair_search.improve(scratch, false);
+        sink += scratch.total_cost;
+    }));
+
+    colony.solutions.assign(max(1, hybrid_params.num_ants), solution);
+    colony.ranking.resize(colony.solutions.size());
+    iota(colony.ranking.begin(), colony.ranking.end(), 0);
+    // Trail updates on the full matrix against the candidate-edge store
+    vector<pair<string, size_t>> trail_memory;
+    for (bool sparse : {false, true}) {
+        string name = string("BM_update_pheromone/") + (sparse ? "sparse" : "dense");
+        init_trails(colony.pheromone, sparse, 1.0);
+        refresh_attractiveness(colony);
+        results.push_back(run_microbenchmark(name, [&] { update_pheromone(colony); }));
+        trail_memory.push_back({name, colony.pheromone.memory_bytes()});
+    }
+    initialize_pheromone(colony, solution.routes);
+
+    // A whole colony iteration on this thread; the first ones grow the pooled
+    // routes and states to the lengths the search reaches
+    mt19937 rng(hybrid_params.seed);
+    int num_routes = solution.routes.size();
+    for (int warm_up = 0; warm_up < 20; warm_up++)
+        colony_iteration(colony, num_routes, &rng);
+    results.push_back(run_microbenchmark("BM_colony_iteration", [&] { colony_iteration(colony, num_routes, &rng); }));
+
+    // Kernels specialized for this instance against the ones checking everything
+    cout << "Binding constraints: " << describe_constraints(constraint_profile) << endl;
+    for (const MicroBenchmarkResult &generic : results) {
+        size_t suffix = generic.name.rfind("/generic");
+        if (suffix == string::npos)
+            continue;
+        for (const MicroBenchmarkResult &specialized : results) {
+            if (specialized.name == generic.name.substr(0, suffix))
+                cout << "  " << specialized.name << ": " << fixed << setprecision(2)
+                     << generic.cpu_ns / specialized.cpu_ns << "x faster than generic" << endl;
         }
-        int pairs_served = total_nodes_visited / 2;
+    }
 
-        all_pairs_served = (pairs_served == required_pairs);
+    cout << "Pheromone trails:" << endl;
+    for (const auto &[name, bytes] : trail_memory)
+        cout << "  " << name << ": " << fixed << setprecision(2) << bytes / 1048576.0 << " MB" << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
 
-        if (!all_pairs_served) {
-            cout << "Served " << pairs_served << " out of " << required_pairs
-                 << " pairs. Increasing number of routes..." << endl;
-            current_routes++;
+    if (!output_file.empty()) {
+        write_microbenchmark_json(output_file, results);
+        cout << "Results written to " << output_file << endl;
+    }
+
+    // The search loop must not touch the heap once its buffers have grown
+    bool steady = true;
+    for (const MicroBenchmarkResult &result : results) {
+        bool loop = result.name == "BM_colony_iteration" || result.name.rfind("BM_local_search_", 0) == 0;
+        if (loop && result.allocations > 0) {
+            cout << "Error: " << result.name << " allocates " << result.allocations << " times per iteration"
+                 << endl;
+            steady = false;
         }
     }
+    return steady;
+}
 
-    if (!all_pairs_served) {
-        cout << "WARNING: Could not serve all pairs even with " << current_routes - 1 << " routes." << endl;
-    } else {
-        cout << "\nAll pairs served successfully using " << best_solution.used_routes << " routes." << endl;
-        cout << "Total cost: " << best_solution.total_cost << endl;
+// Best known solutions from "name vehicles cost" lines (commas allowed)
+map<string, pair<int, double>> read_best_known(const string &filename) {
+    map<string, pair<int, double>> best_known;
+    ifstream file(filename);
+    string line;
+    while (getline(file, line)) {
+        replace(line.begin(), line.end(), ',', ' ');
+        istringstream fields(line);
+        string name;
+        int vehicles;
+        double cost;
+        if (fields >> name >> vehicles >> cost && name[0] != '#')
+            best_known[name] = {vehicles, cost};
+    }
+    return best_known;
+}
+
+struct BenchmarkRow {
+    string instance;
+    int nodes = 0;
+    int runs = 0;
+    int feasible_runs = 0;
+    int best_cost = INT_MAX;
+    double mean_cost = 0;
+    int best_vehicles = INT_MAX;
+    double mean_vehicles = 0;
+    double mean_wall_ms = 0;
+    double max_wall_ms = 0;
+    double target_cost = -1;
+    int ttt_hits = 0;
+    double mean_ttt_ms = 0;
+    int bks_vehicles = -1;
+    double bks_cost = -1;
+};
+
+const char *BENCHMARK_CSV_HEADER = "instance,nodes,runs,feasible_runs,best_cost,mean_cost,best_vehicles,mean_vehicles,"
+                                   "mean_wall_ms,max_wall_ms,target_cost,ttt_hits,mean_ttt_ms,bks_vehicles,bks_cost,"
+                                   "gap_best_pct,gap_mean_pct";
+
+string format_benchmark_row(const BenchmarkRow &row) {
+    auto number = [](double value) {
+        ostringstream out;
+        out << value;
+        return out.str();
+    };
+    auto gap = [&](double cost) {
+        return row.bks_cost > 0 && row.feasible_runs > 0 ? number(100.0 * (cost - row.bks_cost) / row.bks_cost)
+                                                          : string();
+    };
+    auto optional = [&](double value) { return value >= 0 ? number(value) : string(); };
+
+    ostringstream out;
+    out << row.instance << "," << row.nodes << "," << row.runs << "," << row.feasible_runs << ","
+        << (row.feasible_runs ? to_string(row.best_cost) : string()) << "," << row.mean_cost << ","
+        << (row.feasible_runs ? to_string(row.best_vehicles) : string()) << "," << row.mean_vehicles << ","
+        << row.mean_wall_ms << "," << row.max_wall_ms << "," << optional(row.target_cost) << "," << row.ttt_hits
+        << "," << (row.ttt_hits ? number(row.mean_ttt_ms) : string()) << ","
+        << (row.bks_vehicles >= 0 ? to_string(row.bks_vehicles) : string()) << "," << optional(row.bks_cost) << ","
+        << gap(row.best_cost) << "," << gap(row.mean_cost);
+    return out.str();
+}
+
+// instance -> column -> value, from an earlier benchmark CSV
+map<string, map<string, double>> read_benchmark_csv(const string &filename) {
+    map<string, map<string, double>> rows;
+    ifstream file(filename);
+    string line;
+    if (!getline(file, line))
+        return rows;
+    vector<string> columns = split(line, ',');
+    while (getline(file, line)) {
+        vector<string> values = split(line, ',');
+        if (values.empty())
+            continue;
+        for (int c = 1; c < min(columns.size(), values.size()); c++) {
+            if (!values[c].empty())
+                rows[values[0]][columns[c]] = safe_stod(values[c], 0.0);
+        }
+    }
+    return rows;
+}
+
+// Solves every instance file in dir (Sartori & Buriol, Li & Lim or binary)
+// with seeds seed, seed + 1, ... and writes one CSV row per instance: cost and
+// vehicles (best and mean over feasible runs), wall time, time until the first
+// solution within target_gap_pct of the best known cost, and the gap to it.
+// Best known solutions are read from best_known.txt in dir when present.
+int run_benchmark(const string &dir, const string &param_line, int time_limit_ms, int repetitions,
+                  double target_gap_pct, const string &output_file, const string &baseline_file) {
+    namespace fs = std::filesystem;
+    error_code ec;
+    vector<string> files;
+    for (const auto &entry : fs::directory_iterator(dir, ec)) {
+        string name = entry.path().filename().string();
+        if (entry.is_regular_file() && name.rfind("best_known", 0) != 0 && name[0] != '.')
+            files.push_back(entry.path().string());
+    }
+    if (ec || files.empty()) {
+        cout << "Error: No instances found in " << dir << endl;
+        return 1;
+    }
+    sort(files.begin(), files.end());
+
+    map<string, pair<int, double>> best_known = read_best_known((fs::path(dir) / "best_known.txt").string());
+    int num_routes = parse_parameter_line(param_line);
+    // --time-limit wins over a time limit field in the parameter line
+    if (time_limit_ms >= 0)
+        hybrid_params.time_limit_ms = time_limit_ms;
+    HybridParams base_params = hybrid_params;
+    vector<BenchmarkRow> rows;
+
+    cout << "Benchmarking " << files.size() << " instance(s), " << repetitions << " run(s) each" << endl;
+    for (const string &file : files) {
+        BenchmarkRow row;
+        row.instance = fs::path(file).stem().string();
+        string load_error;
+        if (!load_instance(file, instance, load_error)) {
+            cout << "Skipping " << file << ": " << load_error << endl;
+            continue;
+        }
+        if (instance.size == 0) {
+            cout << "Skipping " << file << ": no nodes" << endl;
+            continue;
+        }
+        prepare_instance();
+        row.nodes = instance.size;
+        if (best_known.count(row.instance)) {
+            row.bks_vehicles = best_known[row.instance].first;
+            row.bks_cost = best_known[row.instance].second;
+            row.target_cost = row.bks_cost * (1.0 + target_gap_pct / 100.0);
+        }
+
+        for (int rep = 0; rep < repetitions; rep++) {
+            hybrid_params = base_params;
+            hybrid_params.seed = base_params.seed + rep;
+            worker_pool->reseed(hybrid_params.seed);
+
+            double ttt_ms = -1;
+            on_new_best = [&](const HybridSolution &best) {
+                if (ttt_ms < 0 && row.target_cost >= 0 && best.serves_all() && best.total_cost <= row.target_cost)
+                    ttt_ms = solve_elapsed_ms();
+            };
+
+            auto start = chrono::steady_clock::now();
+            start_solve_clock(start);
+            HybridSolution solution(0);
+            {
+                MuteLog mute;
+                solution = solve_instance(num_routes);
+            }
+            double wall_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            on_new_best = nullptr;
+
+            row.runs++;
+            row.mean_wall_ms += wall_ms;
+            row.max_wall_ms = max(row.max_wall_ms, wall_ms);
+            if (solution.serves_all()) {
+                row.feasible_runs++;
+                row.best_cost = min(row.best_cost, solution.total_cost);
+                row.best_vehicles = min(row.best_vehicles, solution.used_routes);
+                row.mean_cost += solution.total_cost;
+                row.mean_vehicles += solution.used_routes;
+            }
+            if (ttt_ms >= 0) {
+                row.ttt_hits++;
+                row.mean_ttt_ms += ttt_ms;
+            }
+            if (stop_requested)
+                break;
+        }
+
+        row.mean_wall_ms /= max(1, row.runs);
+        row.mean_cost /= max(1, row.feasible_runs);
+        row.mean_vehicles /= max(1, row.feasible_runs);
+        row.mean_ttt_ms /= max(1, row.ttt_hits);
+        rows.push_back(row);
+        cout << row.instance << ": best " << (row.feasible_runs ? to_string(row.best_cost) : string("-"))
+             << ", mean " << row.mean_cost << ", vehicles " << row.mean_vehicles << ", " << row.feasible_runs << "/"
+             << row.runs << " feasible, " << row.mean_wall_ms << " ms/run" << endl;
+        if (stop_requested)
+            break;
+    }
+
+    ofstream csv(output_file);
+    csv << BENCHMARK_CSV_HEADER << "\n";
+    for (const BenchmarkRow &row : rows) {
+        csv << format_benchmark_row(row) << "\n";
+    }
+    csv.close();
+    cout << "Results written to " << output_file << endl;
+
+    if (!baseline_file.empty()) {
+        map<string, map<string, double>> baseline = read_benchmark_csv(baseline_file);
+        cout << "Against " << baseline_file << " (mean cost, mean vehicles, wall time):" << endl;
+        for (const BenchmarkRow &row : rows) {
+            if (!baseline.count(row.instance)) {
+                cout << "  " << row.instance << ": not in baseline" << endl;
+                continue;
+            }
+            map<string, double> &old_row = baseline[row.instance];
+            cout << "  " << row.instance << ": cost " << showpos << row.mean_cost - old_row["mean_cost"]
+                 << ", vehicles " << row.mean_vehicles - old_row["mean_vehicles"] << noshowpos << ", time x"
+                 << (old_row["mean_wall_ms"] > 0 ? row.mean_wall_ms / old_row["mean_wall_ms"] : 0.0) << endl;
+        }
+    }
+    return 0;
+}
+
+// One manifest entry of a batch run and its outcome
+struct BatchJob {
+    string input;
+    string output;
+    string params;
+    int nodes = 0;
+    bool large = false;
+    bool solved = false;
+    int cost = 0;
+    int routes_used = 0;
+    int served_pairs = 0;
+    bool feasible = false;
+    string stopped = "none";
+    string error; // why the instance could not be loaded
+    double solve_ms = 0;
+    double latency_ms = 0; // batch start until the output was written
+};
+
+// Manifest: one instance per line, "input [output [parameter line]]", paths
+// relative to the manifest. Blank lines and lines starting with # are skipped.
+// Without an output the solution goes next to the input as <stem>.out.txt.
+vector<BatchJob> read_batch_manifest(const string &filename) {
+    namespace fs = std::filesystem;
+    vector<BatchJob> jobs;
+    ifstream file(filename);
+    fs::path dir = fs::path(filename).parent_path();
+    string line;
+    while (getline(file, line)) {
+        istringstream fields(line);
+        BatchJob job;
+        if (!(fields >> job.input) || job.input[0] == '#')
+            continue;
+        job.input = (dir / job.input).string();
+        if (fields >> job.output) {
+            job.output = (dir / job.output).string();
+        } else {
+            job.output = fs::path(job.input).replace_extension(".out.txt").string();
+        }
+        getline(fields, job.params);
+        job.params = trim(job.params);
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+// p-th percentile (nearest rank) of unsorted values
+double percentile(vector<double> values, double p) {
+    if (values.empty())
+        return 0;
+    sort(values.begin(), values.end());
+    int rank = (int)ceil(p / 100.0 * values.size());
+    return values[max(0, rank - 1)];
+}
+
+// Solves every instance of a manifest on the shared worker pool. Instances
+// with at least large_nodes nodes run one after another with the whole pool
+// behind their ants; the rest are packed onto the pool's threads, each taking
+// the next small instance as soon as it is free and solving it on its own.
+// Parameters come from the manifest line, then --params, then the first line
+// of a text instance. Prints per-instance results, throughput and p50/p99 of
+// solve time and latency.
+int run_batch(const string &manifest, const string &param_line, int time_limit_ms, int large_nodes) {
+    vector<BatchJob> jobs = read_batch_manifest(manifest);
+    if (jobs.empty()) {
+        cout << "Error: No instances in " << manifest << endl;
+        return 1;
+    }
+
+    HybridParams base_params = hybrid_params;
+    int threads = worker_pool->size();
+    for (BatchJob &job : jobs) {
+        if (!read_instance_size(job.input, job.nodes, job.error) || job.nodes == 0) {
+            if (job.error.empty())
+                job.error = "no nodes";
+            job.nodes = 0;
+            cout << "Skipping " << job.input << ": " << job.error << endl;
+            continue;
+        }
+        job.large = threads > 1 && job.nodes >= large_nodes;
+    }
+    int large_count = count_if(jobs.begin(), jobs.end(), [](const BatchJob &job) { return job.large; });
+    cout << "Batch: " << jobs.size() << " instance(s), " << large_count << " large (>= " << large_nodes
+         << " nodes) on " << threads << " thread(s), the rest packed" << endl;
+
+    auto batch_start = chrono::steady_clock::now();
+
+    // Each lane mutes its own logging while it solves
+    auto solve_job = [&](BatchJob &job, int num_threads) {
+        MuteLog mute;
+        hybrid_params = base_params;
+        int num_routes = !job.params.empty()  ? parse_parameter_line(job.params)
+                         : !param_line.empty() ? parse_parameter_line(param_line)
+                                               : parse_parameters_from_input(job.input);
+        if (time_limit_ms >= 0)
+            hybrid_params.time_limit_ms = time_limit_ms;
+        hybrid_params.num_threads = num_threads;
+        hybrid_params.seed = base_params.seed;
+        worker_pool->reseed(hybrid_params.seed);
+
+        auto start = chrono::steady_clock::now();
+        start_solve_clock(start);
+        if (!load_instance(job.input, instance, job.error))
+            return;
+        prepare_instance();
+        HybridSolution solution = solve_instance(num_routes);
+        write_output(job.output, solution);
+        auto end = chrono::steady_clock::now();
+
+        job.solved = true;
+        job.cost = solution.total_cost;
+        job.routes_used = solution.used_routes;
+        job.served_pairs = solution.served_pairs;
+        job.feasible = solution.serves_all();
+        job.stopped = stop_reason();
+        job.solve_ms = chrono::duration<double, milli>(end - start).count();
+        job.latency_ms = chrono::duration<double, milli>(end - batch_start).count();
+    };
+
+    for (BatchJob &job : jobs) {
+        if (job.large && !stop_requested)
+            solve_job(job, threads);
+    }
+
+    vector<BatchJob *> small_jobs;
+    for (BatchJob &job : jobs) {
+        if (!job.large && job.nodes > 0)
+            small_jobs.push_back(&job);
+    }
+    run_packed(small_jobs.size(), [&](int i) { solve_job(*small_jobs[i], 1); });
+
+    double wall_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - batch_start).count();
+
+    vector<double> solve_times;
+    vector<double> latencies;
+    int feasible = 0;
+    for (const BatchJob &job : jobs) {
+        if (!job.solved) {
+            cout << "  " << job.input << ": not solved" << (job.error.empty() ? "" : " (" + job.error + ")") << endl;
+            continue;
+        }
+        solve_times.push_back(job.solve_ms);
+        latencies.push_back(job.latency_ms);
+        feasible += job.feasible;
+        cout << "  " << job.input << ": " << job.nodes << " nodes" << (job.large ? " (large)" : "") << ", cost "
+             << job.cost << ", " << job.routes_used << " routes, " << (job.feasible ? "feasible" : "infeasible")
+             << ", " << job.solve_ms << " ms" << (job.stopped != "none" ? ", stopped (" + job.stopped + ")" : "")
+             << " -> " << job.output << endl;
     }
+    cout << "Solved " << solve_times.size() << "/" << jobs.size() << " (" << feasible << " feasible) in " << wall_ms
+         << " ms, " << (wall_ms > 0 ? 1000.0 * solve_times.size() / wall_ms : 0.0) << " instances/s" << endl;
+    cout << "Solve time p50 " << percentile(solve_times, 50) << " ms, p99 " << percentile(solve_times, 99)
+         << " ms; latency p50 " << percentile(latencies, 50) << " ms, p99 " << percentile(latencies, 99) << " ms"
+         << endl;
+    return solve_times.size() == jobs.size() ? 0 : 1;
+}
+
+// SIGINT/SIGTERM stop the search; the best solution so far is still written.
+// A second signal terminates immediately.
+void handle_stop_signal(int sig) {
+    stop_requested = true;
+    signal(sig, SIG_DFL);
+}
 
-    write_output(output_file, best_solution);
-    cout << "Solution written to " << output_file << endl;
+void install_stop_handlers() {
+#ifndef _WIN32
+    // No SA_RESTART, so a daemon blocked on input wakes up and exits
+    struct sigaction action = {};
+    action.sa_handler = handle_stop_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+#else
+    signal(SIGINT, handle_stop_signal);
+    signal(SIGTERM, handle_stop_signal);
+#endif
 }
 
 int main(int argc, char *argv[]) {
+    auto process_start = chrono::steady_clock::now();
+    // Logging is redirected by retargeting log_buffer, never by swapping cout's buffer
+    streambuf *stdout_buffer = cout.rdbuf();
+    log_buffer.target = stdout_buffer;
+    cout.rdbuf(&log_buffer);
     string input_file = "input.txt";
     string output_file = "output.txt";
+    string param_line;
+    string socket_path;
+    bool daemon = false;
+    int cache_size = 32;
+    bool seed_given = false;
+    int time_limit_ms = -1;
+    string progress_path;
+    string trace_file;
+    bool microbench = false;
+    string benchmark_dir;
+    int repetitions = 3;
+    double target_gap_pct = 5.0;
+    string bench_out;
+    string baseline_file;
+    string batch_manifest;
+    int batch_large_nodes = 400;
+    int route_cache_size = 1 << 16;
+    string previous_file;
+    OutputFormat output_format = OUTPUT_TEXT;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            hybrid_params.num_threads = max(1, safe_stoi(argv[++i], 1));
+        } else if (arg == "--microbench") {
+            microbench = true;
+        } else if (arg == "--benchmark" && i + 1 < argc) {
+            benchmark_dir = argv[++i];
+        } else if (arg == "--repetitions" && i + 1 < argc) {
+            repetitions = max(1, safe_stoi(argv[++i], 3));
+        } else if (arg == "--target-gap" && i + 1 < argc) {
+            target_gap_pct = safe_stod(argv[++i], 5.0);
+        } else if (arg == "--bench-out" && i + 1 < argc) {
+            bench_out = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baseline_file = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch_manifest = argv[++i];
+        } else if (arg == "--batch-large" && i + 1 < argc) {
+            // Node count from which a batch instance gets the whole pool
+            batch_large_nodes = max(1, safe_stoi(argv[++i], 400));
+        } else if (arg == "--route-cache" && i + 1 < argc) {
+            // Cached route evaluations, 0 = off
+            route_cache_size = max(0, safe_stoi(argv[++i], 1 << 16));
+        } else if (arg == "--previous" && i + 1 < argc) {
+            // Re-optimize this earlier solution for the (updated) input
+            previous_file = argv[++i];
+        } else if (arg == "--lock-time" && i + 1 < argc) {
+            // With --previous, nodes served by this time stay fixed
+            previous_lock_time = safe_stoi(argv[++i], -1);
+        } else if (arg == "--convert" && i + 2 < argc) {
+            // Text instance -> binary instance, e.g. --convert input.txt input.bin
+            Instance inst;
+            string load_error;
+            if (!parse_input(argv[i + 1], inst, load_error) || !check_instance(inst, load_error)) {
+                cout << "Error: " << load_error << endl;
+                return 1;
+            }
+            write_binary_instance(argv[i + 2], inst);
+            cout << "Converted " << argv[i + 1] << " (" << inst.size << " nodes) to " << argv[i + 2] << endl;
+            return 0;
+        } else if (arg == "--input" && i + 1 < argc) {
+            input_file = argv[++i];
+        } else if (arg == "--output" && i + 1 < argc) {
+            // "-" writes the solution to stdout
+            output_file = argv[++i];
+        } else if (arg == "--format" && i + 1 < argc) {
+            // Solution format: text, json (with schedules and stats) or binary
+            if (!parse_output_format(argv[++i], output_format))
+                cout << "Warning: Unknown output format " << argv[i] << ", using text" << endl;
+        } else if (arg == "--params" && i + 1 < argc) {
+            param_line = argv[++i];
+        } else if (arg == "--daemon") {
+            daemon = true;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            daemon = true;
+            socket_path = argv[++i];
+        } else if (arg == "--cache-size" && i + 1 < argc) {
+            cache_size = safe_stoi(argv[++i], 32);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            hybrid_params.seed = (unsigned)safe_stoi(argv[++i], 0);
+            seed_given = true;
+        } else if (arg == "--time-limit" && i + 1 < argc) {
+            time_limit_ms = max(0, safe_stoi(argv[++i], 0));
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (arg == "--progress" && i + 1 < argc) {
+            // NDJSON progress events to a file, or to stdout with "-"
+            progress_path = argv[++i];
+        } else {
+            cout << "Warning: Unknown argument " << arg << endl;
+        }
+    }
+    if (!seed_given) {
+        hybrid_params.seed = random_device{}();
+    }
+    if (time_limit_ms >= 0) {
+        hybrid_params.time_limit_ms = time_limit_ms;
+    }
+    route_cache.configure(route_cache_size);
+    install_stop_handlers();
+
+    if (microbench) {
+        run_matrix_microbench();
+        if (ifstream(input_file)) {
+            if (!param_line.empty() || !is_binary_instance(input_file)) {
+                param_line.empty() ? parse_parameters_from_input(input_file) : parse_parameter_line(param_line);
+            }
+            string load_error;
+            if (!load_instance(input_file, instance, load_error)) {
+                cout << "Error: " << load_error << endl;
+                return 1;
+            }
+            if (!run_solver_microbench(bench_out))
+                return 1;
+        }
+        return 0;
+    }
+
+    if (!benchmark_dir.empty()) {
+        worker_pool = make_unique<WorkerPool>(hybrid_params.num_threads, hybrid_params.seed);
+        return run_benchmark(benchmark_dir, param_line, time_limit_ms, repetitions, target_gap_pct,
+                             bench_out.empty() ? "benchmark.csv" : bench_out, baseline_file);
+    }
+
+    if (!batch_manifest.empty()) {
+        worker_pool = make_unique<WorkerPool>(hybrid_params.num_threads, hybrid_params.seed);
+        return run_batch(batch_manifest, param_line, time_limit_ms, batch_large_nodes);
+    }
+
+    if (daemon) {
+        worker_pool = make_unique<WorkerPool>(hybrid_params.num_threads, hybrid_params.seed);
+        InstanceCache cache(cache_size);
+        if (!socket_path.empty()) {
+#ifndef _WIN32
+            return run_daemon_socket(socket_path, cache);
+#else
+            cout << "Error: --socket is not supported on Windows, use --daemon" << endl;
+            return 1;
+#endif
+        }
+        // stdout carries responses only; solver logging goes to stderr
+        ostream responses(stdout_buffer);
+        log_buffer.target = cerr.rdbuf();
+        run_daemon_stream(cin, responses, cache);
+        return 0;
+    }
+
+    if (progress_path == "-" && output_file == "-") {
+        cout << "Error: --progress - and --output - cannot both write to stdout" << endl;
+        return 1;
+    }
+
+    // With "--progress -" stdout carries the events and logging goes to stderr
+    ostream progress_stdout(stdout_buffer);
+    ofstream progress_file;
+    ostream *progress_out = nullptr;
+    if (progress_path == "-") {
+        log_buffer.target = cerr.rdbuf();
+        progress_out = &progress_stdout;
+    } else if (!progress_path.empty()) {
+        progress_file.open(progress_path);
+        progress_out = &progress_file;
+    }
+    if (progress_out) {
+        progress_sink = [progress_out](const string &event) { *progress_out << event << "\n" << flush; };
+    }
+    // With "--output -" stdout carries the solution and logging goes to stderr
+    if (output_file == "-")
+        log_buffer.target = cerr.rdbuf();
 
     cout << "Using input file: " << input_file << endl;
     cout << "Using output file: " << output_file << endl;
 
-    // Parse parameters from first line of input file
-    int num_routes = parse_parameters_from_input(input_file);
+    // Parameters come from --params or the first line of a text input file
+    int num_routes = param_line.empty() ? parse_parameters_from_input(input_file) : parse_parameter_line(param_line);
+    if (time_limit_ms >= 0) {
+        hybrid_params.time_limit_ms = time_limit_ms;
+    }
+    start_solve_clock(process_start);
 
     cout << "Number of routes: " << num_routes << endl;
+    cout << "Threads: " << hybrid_params.num_threads << ", Seed: " << hybrid_params.seed << endl;
+
+    worker_pool = make_unique<WorkerPool>(hybrid_params.num_threads, hybrid_params.seed);
+
+    if (!previous_file.empty()) {
+        ifstream previous(previous_file);
+        if (!previous) {
+            cout << "Error: Cannot open previous solution " << previous_file << endl;
+            return 1;
+        }
+        previous_plan = parse_solution_routes(string(istreambuf_iterator<char>(previous), {}));
+        cout << "Previous solution: " << previous_file << " (" << previous_plan.size() << " routes)" << endl;
+    }
 
-    solve(input_file, output_file, num_routes);
+    solve(input_file, output_file, num_routes, trace_file, output_format);
     return 0;
 }
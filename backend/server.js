@@ -3,7 +3,7 @@ const express = require('express');
 const path = require('path');
 const fs = require('fs');
 const os = require('os');
-const { execFile } = require('child_process');
+const { execFile, spawn } = require('child_process');
 const cors = require('cors');
 
 const app = express();
@@ -12,6 +12,10 @@ const PORT = process.env.PORT || 3001;
 const HOST = process.env.HOST || '0.0.0.0';
 const CORS_ORIGIN = process.env.CORS_ORIGIN || '*';
 const MAX_FILE_SIZE = process.env.MAX_FILE_SIZE || '5mb';
+// Worker threads for the ant colony (defaults to all cores)
+const SOLVER_THREADS = process.env.SOLVER_THREADS || os.cpus().length;
+// Hard upper bound per solve; the solver gets SIGTERM and still writes its best solution
+const SOLVER_TIMEOUT_MS = parseInt(process.env.SOLVER_TIMEOUT_MS || '0', 10);
 // Prefer a Linux binary if present, otherwise fall back to env or Windows .exe
 let ALGORITHM_EXECUTABLE = process.env.ALGORITHM_EXECUTABLE || 'PDPTW_HYBRID_ACO_GREEDY_V3';
 // If the linux binary not present but .exe exists, use that (for local Windows dev)
@@ -22,6 +26,127 @@ if (!fs.existsSync(path.join(__dirname, ALGORITHM_EXECUTABLE))) {
     }
 }
 
+// Keep one solver process alive and talk NDJSON over stdin/stdout instead of
+// spawning the binary per request
+const USE_SOLVER_DAEMON = process.env.SOLVER_DAEMON === 'true';
+let solverDaemon = null;
+let nextSolveId = 1;
+const pendingSolves = new Map();
+
+function getSolverDaemon() {
+    if (solverDaemon) {
+        return solverDaemon;
+    }
+
+    const exePath = path.join(__dirname, ALGORITHM_EXECUTABLE);
+    solverDaemon = spawn(exePath, ['--daemon', '--threads', String(SOLVER_THREADS)], { stdio: ['pipe', 'pipe', 'pipe'] });
+    console.log('Solver daemon started, pid', solverDaemon.pid);
+
+    let buffer = '';
+    solverDaemon.stdout.on('data', (chunk) => {
+        buffer += chunk;
+        let newline;
+        while ((newline = buffer.indexOf('\n')) >= 0) {
+            const line = buffer.slice(0, newline);
+            buffer = buffer.slice(newline + 1);
+            if (!line.trim()) {
+                continue;
+            }
+            let message;
+            try {
+                message = JSON.parse(line);
+            } catch (err) {
+                console.warn('Unparsable solver daemon output:', line);
+                continue;
+            }
+            const pending = pendingSolves.get(message.id);
+            if (!pending) {
+                continue;
+            }
+            if (message.event) {
+                // Progress event for a request that asked for them
+                if (pending.onEvent) {
+                    pending.onEvent(message);
+                }
+                continue;
+            }
+            pendingSolves.delete(message.id);
+            pending.resolve(message);
+        }
+    });
+    // Solver log goes to stderr; drain it so the pipe never blocks the daemon
+    solverDaemon.stderr.resume();
+    solverDaemon.on('exit', (code, signal) => {
+        console.warn('Solver daemon exited', code, signal);
+        solverDaemon = null;
+        for (const pending of pendingSolves.values()) {
+            pending.resolve({ success: false, error: 'Solver daemon exited' });
+        }
+        pendingSolves.clear();
+    });
+    return solverDaemon;
+}
+
+// SOLVER_TIMEOUT_MS for daemon solves. The shared daemon cannot be killed for
+// one request, so the bound is passed as the request's time limit instead and
+// the solver returns its best solution when it runs out
+function daemonTimeLimit(params) {
+    if (SOLVER_TIMEOUT_MS <= 0) {
+        return undefined;
+    }
+    const own = parseInt(params.time_limit_ms || process.env.DEFAULT_TIME_LIMIT_MS || '0', 10);
+    return own > 0 ? Math.min(own, SOLVER_TIMEOUT_MS) : SOLVER_TIMEOUT_MS;
+}
+
+function solveWithDaemon(paramLine, instance, seed, onEvent, format, timeLimitMs) {
+    return new Promise((resolve) => {
+        const id = nextSolveId++;
+        pendingSolves.set(id, { resolve, onEvent });
+        const request = { id, params: paramLine, instance };
+        if (seed !== undefined) {
+            request.seed = seed;
+        }
+        if (timeLimitMs !== undefined) {
+            request.time_limit_ms = timeLimitMs;
+        }
+        if (format) {
+            request.format = format;
+        }
+        if (onEvent) {
+            request.progress = true;
+        }
+        getSolverDaemon().stdin.write(JSON.stringify(request) + '\n');
+    });
+}
+
+// Solver parameter line, in the field order parse_parameter_line expects
+function buildParamLine(params) {
+    return [
+        params.num_routes || process.env.DEFAULT_NUM_ROUTES || 10,
+        params.ants || process.env.DEFAULT_ANTS || 10,
+        params.iterations || process.env.DEFAULT_ITERATIONS || 20,
+        params.alpha || process.env.DEFAULT_ALPHA || 2.0,
+        params.beta || process.env.DEFAULT_BETA || 5.0,
+        params.rho || process.env.DEFAULT_RHO || 0.1,
+        params.tau_max || process.env.DEFAULT_TAU_MAX || 50.0,
+        params.tau_min || process.env.DEFAULT_TAU_MIN || 0.01,
+        params.greedy_bias || process.env.DEFAULT_GREEDY_BIAS || 0.85,
+        params.elite_solutions || process.env.DEFAULT_ELITE_SOLUTIONS || 4,
+        params.local_search_prob || process.env.DEFAULT_LOCAL_SEARCH_PROB || 0.7,
+        params.restart_threshold || process.env.DEFAULT_RESTART_THRESHOLD || 2,
+        params.regret_k || process.env.DEFAULT_REGRET_K || 1,
+        params.granular_k || process.env.DEFAULT_GRANULAR_K || 0,
+        params.local_search ?? process.env.DEFAULT_LOCAL_SEARCH ?? 1,
+        params.time_limit_ms || process.env.DEFAULT_TIME_LIMIT_MS || 0,
+        params.islands || process.env.DEFAULT_ISLANDS || 1,
+        params.migration_interval || process.env.DEFAULT_MIGRATION_INTERVAL || 5,
+        params.migration_blend ?? process.env.DEFAULT_MIGRATION_BLEND ?? 0.2,
+        params.cluster_pairs || process.env.DEFAULT_CLUSTER_PAIRS || 0,
+        params.alns_iterations || process.env.DEFAULT_ALNS_ITERATIONS || 0,
+        params.elite_pool || process.env.DEFAULT_ELITE_POOL || 0
+    ].join(' ');
+}
+
 const BASE_WORK_DIR = process.env.APP_WORK_DIR || path.join(os.tmpdir(), 'wayo');
 try {
     fs.mkdirSync(BASE_WORK_DIR, { recursive: true });
@@ -45,20 +170,21 @@ app.post('/api/solve', (req, res) => {
         return res.status(400).json({ success: false, error: 'Thiếu dữ liệu instance hoặc tham số.' });
     }
 
-    const paramLine = [
-        params.num_routes || process.env.DEFAULT_NUM_ROUTES || 10,
-        params.ants || process.env.DEFAULT_ANTS || 10,
-        params.iterations || process.env.DEFAULT_ITERATIONS || 20,
-        params.alpha || process.env.DEFAULT_ALPHA || 2.0,
-        params.beta || process.env.DEFAULT_BETA || 5.0,
-        params.rho || process.env.DEFAULT_RHO || 0.1,
-        params.tau_max || process.env.DEFAULT_TAU_MAX || 50.0,
-        params.tau_min || process.env.DEFAULT_TAU_MIN || 0.01,
-        params.greedy_bias || process.env.DEFAULT_GREEDY_BIAS || 0.85,
-        params.elite_solutions || process.env.DEFAULT_ELITE_SOLUTIONS || 4,
-        params.local_search_prob || process.env.DEFAULT_LOCAL_SEARCH_PROB || 0.7,
-        params.restart_threshold || process.env.DEFAULT_RESTART_THRESHOLD || 2
-    ].join(' ');
+    const paramLine = buildParamLine(params);
+    // With params.format "json" the result is an object with per-stop
+    // schedules, loads, slack and per-route costs instead of the text format
+    const jsonOutput = params.format === 'json';
+
+    if (USE_SOLVER_DAEMON) {
+        const format = jsonOutput ? 'json' : undefined;
+        return solveWithDaemon(paramLine, instance, params.seed, null, format, daemonTimeLimit(params)).then((response) => {
+            if (!response.success) {
+                console.log('Solver daemon error:', response.error);
+                return res.status(500).json({ success: false, error: response.error });
+            }
+            res.json({ success: true, result: response.result });
+        });
+    }
 
     let workDir = '';
     try {
@@ -91,13 +217,35 @@ app.post('/api/solve', (req, res) => {
 
     const exePath = path.join(__dirname, ALGORITHM_EXECUTABLE);
     console.log('Running exe:', exePath, 'in', workDir);
-    execFile(exePath, [], { cwd: workDir }, (error, stdout, stderr) => {
-        if (error) {
+    const solverArgs = ['--threads', String(params.threads || SOLVER_THREADS)];
+    if (params.seed !== undefined) {
+        solverArgs.push('--seed', String(params.seed));
+    }
+    if (jsonOutput) {
+        // Solution on stdout, no output file to read back
+        solverArgs.push('--format', 'json', '--output', '-');
+    }
+    const execOptions = { cwd: workDir, timeout: SOLVER_TIMEOUT_MS, killSignal: 'SIGTERM', maxBuffer: 64 * 1024 * 1024 };
+    execFile(exePath, solverArgs, execOptions, (error, stdout, stderr) => {
+        // A solver stopped by the timeout has still written its best solution
+        const timedOut = error && error.killed &&
+            (jsonOutput ? stdout.length > 0 : fs.existsSync(path.join(workDir, 'output.txt')));
+        if (error && !timedOut) {
             console.log('Error running exe:', error, stderr);
             cleanup();
             return res.status(500).json({ success: false, error: stderr || error.message });
         }
 
+        if (jsonOutput) {
+            cleanup();
+            try {
+                return res.json({ success: true, result: JSON.parse(stdout) });
+            } catch (e) {
+                console.log('Unparsable solver output:', e);
+                return res.status(500).json({ success: false, error: 'Không đọc được kết quả của solver' });
+            }
+        }
+
         const outputPath = path.join(workDir, 'output.txt');
         let result = '';
         try {
@@ -112,6 +260,96 @@ app.post('/api/solve', (req, res) => {
     });
 });
 
+// Same as /api/solve, but answers with NDJSON: one {"event":"progress"} line
+// per colony iteration (with the routes whenever the best solution improves),
+// then a final {"event":"result"} line. SOLVER_TIMEOUT_MS applies in both modes.
+// Closing the connection cancels the solve only with a spawned solver; the
+// daemon works through its requests in order, so there the solve runs to its
+// time limit and the result is dropped.
+app.post('/api/solve/stream', (req, res) => {
+    const { instance, params } = req.body;
+    console.log('POST /api/solve/stream called');
+    if (!instance || !params) {
+        return res.status(400).json({ success: false, error: 'Thiếu dữ liệu instance hoặc tham số.' });
+    }
+
+    const paramLine = buildParamLine(params);
+    res.setHeader('Content-Type', 'application/x-ndjson');
+    const send = (message) => {
+        if (!res.writableEnded && !res.destroyed) {
+            res.write(JSON.stringify(message) + '\n');
+        }
+    };
+
+    if (USE_SOLVER_DAEMON) {
+        return solveWithDaemon(paramLine, instance, params.seed, send, undefined, daemonTimeLimit(params)).then((response) => {
+            send({ event: 'result', success: response.success, result: response.result, error: response.error });
+            res.end();
+        });
+    }
+
+    let workDir = '';
+    try {
+        workDir = fs.mkdtempSync(path.join(BASE_WORK_DIR, 'job-'));
+        fs.writeFileSync(path.join(workDir, 'input.txt'), paramLine + '\n' + instance, 'utf8');
+    } catch (err) {
+        console.error('Failed to prepare solver job:', err);
+        send({ event: 'result', success: false, error: 'Không ghi được file input.txt' });
+        return res.end();
+    }
+
+    const exePath = path.join(__dirname, ALGORITHM_EXECUTABLE);
+    const solverArgs = ['--threads', String(params.threads || SOLVER_THREADS), '--progress', '-'];
+    if (params.seed !== undefined) {
+        solverArgs.push('--seed', String(params.seed));
+    }
+    const solver = spawn(exePath, solverArgs, { cwd: workDir, stdio: ['ignore', 'pipe', 'pipe'] });
+    const timer = SOLVER_TIMEOUT_MS > 0 ? setTimeout(() => solver.kill('SIGTERM'), SOLVER_TIMEOUT_MS) : null;
+    let finished = false;
+    res.on('close', () => {
+        if (!finished) {
+            solver.kill('SIGTERM');
+        }
+    });
+
+    let buffer = '';
+    solver.stdout.on('data', (chunk) => {
+        buffer += chunk;
+        let newline;
+        while ((newline = buffer.indexOf('\n')) >= 0) {
+            const line = buffer.slice(0, newline);
+            buffer = buffer.slice(newline + 1);
+            if (line.trim()) {
+                res.write(line + '\n');
+            }
+        }
+    });
+    let stderr = '';
+    solver.stderr.on('data', (chunk) => {
+        stderr += chunk;
+    });
+
+    solver.on('close', (code) => {
+        finished = true;
+        if (timer) {
+            clearTimeout(timer);
+        }
+        const outputPath = path.join(workDir, 'output.txt');
+        if (fs.existsSync(outputPath)) {
+            send({ event: 'result', success: true, result: fs.readFileSync(outputPath, 'utf8') });
+        } else {
+            console.log('Solver exited without output:', code, stderr);
+            send({ event: 'result', success: false, error: 'Không đọc được file output.txt' });
+        }
+        res.end();
+        try {
+            fs.rmSync(workDir, { recursive: true, force: true });
+        } catch (cleanupErr) {
+            console.warn('Failed to clean up work dir', workDir, cleanupErr);
+        }
+    });
+});
+
 // simple health check for platform probes
 app.get('/health', (req, res) => {
     res.json({ status: 'ok' });